@@ -0,0 +1,137 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../core/edge_sort.h"
+#include "../core/graph.h"
+#include "../core/utils.h"
+
+#define DEFAULT_EDGES "16000000"
+#define DEFAULT_REPEAT "3"
+#define DEFAULT_SEED "1"
+
+// One edge array to sort. Only the weights matter to the sorts, the
+// endpoints just give the edges their real size.
+struct Distribution {
+  std::string name;
+  std::vector<edge_t> edges;
+};
+
+Distribution input_distribution(const std::string &input_file_path) {
+  Graph g;
+  g.readGraph(input_file_path);
+  return Distribution{"input",
+                      std::vector<edge_t>(g.edges.begin(), g.edges.end())};
+}
+
+// m edges with weights uniform in [min_weight, max_weight].
+Distribution random_distribution(const std::string &name, size_t m,
+                                 uintE min_weight, uintE max_weight,
+                                 uint seed) {
+  Distribution distribution{name, std::vector<edge_t>(m)};
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uintE> weight(min_weight, max_weight);
+  for (size_t i = 0; i < m; i++) {
+    distribution.edges[i] = edge_t(i, i + 1, weight(rng));
+  }
+  return distribution;
+}
+
+// Copies distribution, sorts the copy with method repeat times and returns
+// the best time. sorted tells whether every run came out in weight order.
+double run_sort(const Distribution &distribution, SortMethod method,
+                uint n_threads, uint repeat, bool &sorted) {
+  double best = 0;
+  sorted = true;
+  std::vector<edge_t> edges;
+  for (uint r = 0; r < repeat; r++) {
+    edges = distribution.edges;
+    timer t;
+    t.start();
+    sortEdgesByWeight(edges.data(), edges.size(), method, n_threads);
+    double time = t.stop();
+    if (r == 0 || time < best) best = time;
+    sorted = sorted &&
+             std::is_sorted(edges.begin(), edges.end(), edge_weight_less);
+  }
+  return best;
+}
+
+// Compares the --sort backends on edge arrays of the weight distributions
+// the engines see: the input graph (if given), the generator's small
+// weights, uniform 31-bit weights, weights already in order, in reverse
+// order, and with both signs. Build with `make openmp` for a parallel
+// quick. Prints the best of repeat runs per backend and exits with 1 if
+// any result is out of order.
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("Sort_Bench", "Edge sort benchmark");
+  options.add_options(
+      "custom",
+      {{"inputFile", "Input graph file path (optional)",
+        cxxopts::value<std::string>()->default_value("")},
+       {"edges", "Number of edges of the generated distributions",
+        cxxopts::value<size_t>()->default_value(DEFAULT_EDGES)},
+       {"nThreads", "Number of Threads",
+        cxxopts::value<uint>()->default_value(DEFAULT_NUMBER_OF_THREADS)},
+       {"repeat", "Runs per backend; the best time is reported",
+        cxxopts::value<uint>()->default_value(DEFAULT_REPEAT)},
+       {"seed", "Seed of the generated distributions",
+        cxxopts::value<uint>()->default_value(DEFAULT_SEED)}});
+  auto cl_options = options.parse(argc, argv);
+  std::string input_file_path = cl_options["inputFile"].as<std::string>();
+  size_t m = cl_options["edges"].as<size_t>();
+  uint n_threads = std::max(1u, cl_options["nThreads"].as<uint>());
+  uint repeat = std::max(1u, cl_options["repeat"].as<uint>());
+  uint seed = cl_options["seed"].as<uint>();
+
+  std::vector<Distribution> distributions;
+  if (!input_file_path.empty()) {
+    distributions.push_back(input_distribution(input_file_path));
+  }
+  distributions.push_back(random_distribution("small", m, 1, 1000, seed));
+  distributions.push_back(
+      random_distribution("uniform", m, 0, UINTV_MAX, seed));
+  Distribution ascending = random_distribution("sorted", m, 0, UINTV_MAX,
+                                               seed);
+  std::sort(ascending.edges.begin(), ascending.edges.end(), edge_weight_less);
+  Distribution descending{"reversed", std::vector<edge_t>(
+                                          ascending.edges.rbegin(),
+                                          ascending.edges.rend())};
+  distributions.push_back(std::move(ascending));
+  distributions.push_back(std::move(descending));
+  distributions.push_back(
+      random_distribution("signed", m, -UINTV_MAX, UINTV_MAX, seed));
+
+  const struct {
+    const char *name;
+    SortMethod method;
+  } backends[] = {{"std", STD_SORT},
+                  {"quick", QUICK_SORT},
+                  {"radix", RADIX_SORT},
+                  {"radix_keys", RADIX_SORT_KEYS}};
+  bool passed = true;
+  std::cout << "Number of Threads : " << n_threads << std::endl;
+  std::cout << std::setw(10) << "weights" << std::setw(12) << "sort"
+            << std::setw(12) << "time (s)" << std::setw(14) << "Medges/s"
+            << std::setw(8) << "check" << std::endl;
+  for (const auto &distribution : distributions) {
+    for (const auto &backend : backends) {
+      bool sorted;
+      double time =
+          run_sort(distribution, backend.method, n_threads, repeat, sorted);
+      passed = passed && sorted;
+      std::cout << std::setw(10) << distribution.name << std::setw(12)
+                << backend.name << std::setw(12) << std::fixed
+                << std::setprecision(5) << time << std::setw(14)
+                << std::setprecision(1)
+                << distribution.edges.size() / time / 1e6 << std::setw(8)
+                << (sorted ? "ok" : "FAILED") << std::endl;
+    }
+  }
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../core/edge_sort.h"
+#include "../core/graph.h"
+#include "../core/utils.h"
+
+#define DEFAULT_VERTICES "1000000"
+#define DEFAULT_EDGES "8000000"
+#define DEFAULT_REPEAT "3"
+#define DEFAULT_SEED "1"
+
+// One workload: the unites a Kruskal scan issues for a graph shape.
+struct Shape {
+  std::string name;
+  uintV n;
+  std::vector<edge_t> edges;
+};
+
+// Edges of the input graph in ascending weight order, the order in which
+// every engine feeds them to its UnionFind.
+Shape input_shape(const std::string &input_file_path) {
+  Graph g;
+  g.readGraph(input_file_path);
+  Shape shape{"input", g.n_, std::vector<edge_t>(g.edges.begin(),
+                                                 g.edges.end())};
+  sortEdgesByWeight(shape.edges.data(), shape.edges.size(), STD_SORT);
+  return shape;
+}
+
+// A path whose edges arrive from the far end, then again as parallel
+// edges. Linking by index alone builds a single chain n deep that the
+// first find of the second pass has to walk.
+Shape chain_shape(uintV n) {
+  Shape shape{"chain", n, std::vector<edge_t>()};
+  for (int pass = 0; pass < 2; pass++) {
+    for (uintV v = n - 1; v > 0; v--) shape.edges.emplace_back(v - 1, v, 0);
+  }
+  return shape;
+}
+
+// Uniformly random edges, the same for every run with the same seed.
+Shape random_shape(uintV n, size_t m, uint seed) {
+  Shape shape{"random", n, std::vector<edge_t>(m)};
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uintV> vertex(0, n - 1);
+  for (auto &edge : shape.edges) {
+    edge.from = vertex(rng);
+    edge.to = vertex(rng);
+  }
+  return shape;
+}
+
+// Runs the unites of shape on a fresh BasicUnionFind<Link, Compress>
+// repeat times and returns the best time. joined is the number of unites
+// that joined two sets, which every policy must agree on.
+template <class Link, class Compress>
+double run_policy(const Shape &shape, uint repeat, size_t &joined) {
+  double best = 0;
+  for (uint r = 0; r < repeat; r++) {
+    timer t;
+    t.start();
+    BasicUnionFind<Link, Compress> union_find(shape.n);
+    size_t count = 0;
+    for (const auto &edge : shape.edges) {
+      if (union_find.unite(edge.from, edge.to)) count++;
+    }
+    double time = t.stop();
+    if (r == 0 || time < best) best = time;
+    joined = count;
+  }
+  return best;
+}
+
+template <class Link, class Compress>
+bool report_policy(const Shape &shape, uint repeat, const char *link,
+                   const char *compress, size_t &expected_joined) {
+  size_t joined = 0;
+  double time = run_policy<Link, Compress>(shape, repeat, joined);
+  bool ok = expected_joined == size_t(-1) || joined == expected_joined;
+  if (expected_joined == size_t(-1)) expected_joined = joined;
+  std::cout << std::setw(8) << shape.name << std::setw(13) << link
+            << std::setw(17) << compress << std::setw(12) << std::fixed
+            << std::setprecision(5) << time << std::setw(8)
+            << (ok ? "ok" : "FAILED") << std::endl;
+  return ok;
+}
+
+template <class Link>
+bool report_link(const Shape &shape, uint repeat, const char *link,
+                 size_t &expected_joined) {
+  bool ok = report_policy<Link, FullCompression>(
+      shape, repeat, link, "FullCompression", expected_joined);
+  ok = report_policy<Link, PathHalving>(shape, repeat, link, "PathHalving",
+                                        expected_joined) &&
+       ok;
+  ok = report_policy<Link, PathSplitting>(shape, repeat, link,
+                                          "PathSplitting", expected_joined) &&
+       ok;
+  return ok;
+}
+
+// Microbenchmark of every BasicUnionFind link and compress policy on the
+// graph shapes the engines see: the input graph (if given) in Kruskal
+// order, a long path, and random edges. Prints the best of repeat runs per
+// policy and exits with 1 if two policies disagree on the number of
+// successful unites.
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("Union_Find_Bench",
+                           "UnionFind policy microbenchmark");
+  options.add_options(
+      "custom",
+      {{"inputFile", "Input graph file path (optional)",
+        cxxopts::value<std::string>()->default_value("")},
+       {"vertices", "Number of vertices of the chain and random shapes",
+        cxxopts::value<uintV>()->default_value(DEFAULT_VERTICES)},
+       {"edges", "Number of edges of the random shape",
+        cxxopts::value<size_t>()->default_value(DEFAULT_EDGES)},
+       {"repeat", "Runs per policy; the best time is reported",
+        cxxopts::value<uint>()->default_value(DEFAULT_REPEAT)},
+       {"seed", "Seed of the random shape",
+        cxxopts::value<uint>()->default_value(DEFAULT_SEED)}});
+  auto cl_options = options.parse(argc, argv);
+  std::string input_file_path = cl_options["inputFile"].as<std::string>();
+  uintV n = std::max<uintV>(1, cl_options["vertices"].as<uintV>());
+  size_t m = cl_options["edges"].as<size_t>();
+  uint repeat = std::max(1u, cl_options["repeat"].as<uint>());
+
+  std::vector<Shape> shapes;
+  if (!input_file_path.empty()) shapes.push_back(input_shape(input_file_path));
+  shapes.push_back(chain_shape(n));
+  shapes.push_back(random_shape(n, m, cl_options["seed"].as<uint>()));
+
+  bool passed = true;
+  std::cout << std::setw(8) << "shape" << std::setw(13) << "link"
+            << std::setw(17) << "compress" << std::setw(12) << "time (s)"
+            << std::setw(8) << "check" << std::endl;
+  for (const auto &shape : shapes) {
+    size_t expected_joined = size_t(-1);
+    passed = report_link<LinkByIndex>(shape, repeat, "LinkByIndex",
+                                      expected_joined) &&
+             passed;
+    passed = report_link<LinkBySize>(shape, repeat, "LinkBySize",
+                                     expected_joined) &&
+             passed;
+    passed = report_link<LinkByRank>(shape, repeat, "LinkByRank",
+                                     expected_joined) &&
+             passed;
+    passed =
+        report_link<LinkRem>(shape, repeat, "LinkRem", expected_joined) &&
+        passed;
+  }
+  return passed ? 0 : 1;
+}
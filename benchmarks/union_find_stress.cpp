@@ -0,0 +1,148 @@
+#include <stdint.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../core/parallel.h"
+#include "../core/utils.h"
+
+#define DEFAULT_VERTICES "1000000"
+#define DEFAULT_UNIONS "4000000"
+#define DEFAULT_MAX_THREADS "64"
+#define DEFAULT_SEED "1"
+
+typedef std::pair<uintV, uintV> vertex_pair;
+
+// Random pairs over [0, n), the same for every run with the same seed.
+std::vector<vertex_pair> random_pairs(uintV n, size_t count, uint seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uintV> vertex(0, n - 1);
+  std::vector<vertex_pair> pairs(count);
+  for (auto &pair : pairs) {
+    pair.first = vertex(rng);
+    pair.second = vertex(rng);
+  }
+  return pairs;
+}
+
+// Unites all pairs on n_threads threads, each taking an interleaved share so
+// that the threads keep racing on the same trees. Returns the number of
+// unites that joined two sets.
+template <class UF>
+size_t unite_all(UF &union_find, const std::vector<vertex_pair> &pairs,
+                 uint n_threads) {
+  std::vector<size_t> joined(n_threads, 0);
+  parallel_run(n_threads, [&](uint t) {
+    for (size_t i = t; i < pairs.size(); i += n_threads) {
+      if (union_find.unite(pairs[i].first, pairs[i].second)) joined[t]++;
+    }
+  });
+  size_t total = 0;
+  for (size_t count : joined) total += count;
+  return total;
+}
+
+// UnionFind behind one lock, the scheme ConcurrentUnionFind replaced.
+class MutexUnionFind {
+  UnionFind sets_;
+  std::mutex mutex_;
+
+ public:
+  explicit MutexUnionFind(int num_of_vertices) : sets_(num_of_vertices) {}
+
+  bool unite(uintV vertex1, uintV vertex2) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return sets_.unite(vertex1, vertex2);
+  }
+};
+
+// Checks a concurrent run against a sequential UnionFind over the same
+// pairs: the same number of successful unites, hence the same number of
+// sets, and every vertex in the same set as the first vertex the sequential
+// run put in its set. Together these make the two partitions equal.
+bool check(uintV n, const std::vector<vertex_pair> &pairs, uint n_threads) {
+  UnionFind expected(n);
+  size_t expected_joined = 0;
+  for (const auto &pair : pairs) {
+    if (expected.unite(pair.first, pair.second)) expected_joined++;
+  }
+  ConcurrentUnionFind actual(n);
+  size_t joined = unite_all(actual, pairs, n_threads);
+  if (joined != expected_joined) {
+    std::cout << n_threads << " threads: " << joined
+              << " successful unites, expected " << expected_joined
+              << std::endl;
+    return false;
+  }
+  std::vector<uintV> representative(n, -1);
+  for (uintV v = 0; v < n; v++) {
+    uintV &first = representative[expected.find(v)];
+    if (first == -1) first = v;
+    if (actual.find(v) != actual.find(first) ||
+        !actual.sameSet(v, first)) {
+      std::cout << n_threads << " threads: vertex " << v
+                << " is not in the set of vertex " << first << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Stress test and throughput comparison for ConcurrentUnionFind. Every
+// thread count from 1 to maxThreads (doubling) first runs the random unites
+// on ConcurrentUnionFind and checks the result against a sequential
+// UnionFind, then times them on ConcurrentUnionFind and on a mutex-guarded
+// UnionFind. Exits with 1 if any check fails.
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("Union_Find_Stress",
+                           "ConcurrentUnionFind stress test and benchmark");
+  options.add_options(
+      "custom",
+      {{"vertices", "Number of vertices",
+        cxxopts::value<uintV>()->default_value(DEFAULT_VERTICES)},
+       {"unions", "Number of random unites per run",
+        cxxopts::value<size_t>()->default_value(DEFAULT_UNIONS)},
+       {"maxThreads", "Largest thread count to run",
+        cxxopts::value<uint>()->default_value(DEFAULT_MAX_THREADS)},
+       {"seed", "Seed of the random pairs",
+        cxxopts::value<uint>()->default_value(DEFAULT_SEED)}});
+  auto cl_options = options.parse(argc, argv);
+  uintV n = std::max<uintV>(1, cl_options["vertices"].as<uintV>());
+  size_t unions = cl_options["unions"].as<size_t>();
+  uint max_threads = std::max(1u, cl_options["maxThreads"].as<uint>());
+  std::vector<vertex_pair> pairs =
+      random_pairs(n, unions, cl_options["seed"].as<uint>());
+
+  bool passed = true;
+  std::cout << std::setw(8) << "threads" << std::setw(12) << "check"
+            << std::setw(20) << "lock-free Mops/s" << std::setw(16)
+            << "mutex Mops/s" << std::endl;
+  for (uint n_threads = 1; n_threads <= max_threads; n_threads *= 2) {
+    bool ok = check(n, pairs, n_threads);
+    passed = passed && ok;
+
+    timer t;
+    ConcurrentUnionFind lock_free(n);
+    t.start();
+    unite_all(lock_free, pairs, n_threads);
+    double lock_free_time = t.stop();
+
+    MutexUnionFind locked(n);
+    t.start();
+    unite_all(locked, pairs, n_threads);
+    double locked_time = t.stop();
+
+    std::cout << std::setw(8) << n_threads << std::setw(12)
+              << (ok ? "ok" : "FAILED") << std::setw(20)
+              << unions / lock_free_time / 1e6 << std::setw(16)
+              << unions / locked_time / 1e6 << std::endl;
+  }
+  std::cout << (passed ? "All checks passed" : "Some checks FAILED")
+            << std::endl;
+  return passed ? 0 : 1;
+}
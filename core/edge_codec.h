@@ -0,0 +1,131 @@
+#ifndef EDGE_CODEC_H
+#define EDGE_CODEC_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <vector>
+
+#include "graph.h"
+
+// Stream VByte coding of 32-bit integers. Every value is stored in 1 to 4
+// little-endian bytes, and its length goes into a separate control stream,
+// 2 bits per value and four values per control byte. Keeping the lengths
+// apart from the data avoids the per-byte continuation tests of classic
+// varints: a decoder reads one control byte and knows where the next four
+// values are, which is also what lets SIMD decoders expand them with a
+// single shuffle.
+inline size_t streamvbyte_max_bytes(size_t n) { return (n + 3) / 4 + 4 * n; }
+
+inline uint32_t streamvbyte_length(uint32_t value) {
+  if (value < (1u << 8)) return 1;
+  if (value < (1u << 16)) return 2;
+  if (value < (1u << 24)) return 3;
+  return 4;
+}
+
+// Encodes in[0, n) into out, which needs streamvbyte_max_bytes(n) bytes, and
+// returns the number of bytes written.
+inline size_t streamvbyte_encode(const uint32_t *in, size_t n, uint8_t *out) {
+  uint8_t *control = out;
+  uint8_t *data = out + (n + 3) / 4;
+  memset(control, 0, (n + 3) / 4);
+  for (size_t i = 0; i < n; i++) {
+    uint32_t value = in[i];
+    uint32_t length = streamvbyte_length(value);
+    control[i / 4] |= (length - 1) << (2 * (i % 4));
+    for (uint32_t b = 0; b < length; b++) data[b] = value >> (8 * b);
+    data += length;
+  }
+  return data - out;
+}
+
+// Decodes n values from in, reading at most bytes bytes, into out. Returns
+// the number of bytes consumed, or 0 if the input is truncated.
+inline size_t streamvbyte_decode(const uint8_t *in, size_t bytes, size_t n,
+                                 uint32_t *out) {
+  size_t control_bytes = (n + 3) / 4;
+  if (bytes < control_bytes) return 0;
+  const uint8_t *control = in;
+  const uint8_t *data = in + control_bytes;
+  const uint8_t *end = in + bytes;
+  for (size_t i = 0; i < n; i++) {
+    uint32_t length = ((control[i / 4] >> (2 * (i % 4))) & 3) + 1;
+    if (size_t(end - data) < length) return 0;
+    uint32_t value = 0;
+    for (uint32_t b = 0; b < length; b++) {
+      value |= uint32_t(data[b]) << (8 * b);
+    }
+    out[i] = value;
+    data += length;
+  }
+  return data - in;
+}
+
+// Maps the wrapped difference a - b to a small unsigned value when a and b
+// are close, whichever is larger.
+inline uint32_t zigzag_delta(int32_t a, int32_t b) {
+  uint32_t delta = uint32_t(a) - uint32_t(b);
+  return (delta << 1) ^ (0u - (delta >> 31));
+}
+
+// Inverse of zigzag_delta: returns a given b.
+inline int32_t zigzag_undelta(uint32_t value, int32_t b) {
+  return int32_t(uint32_t(b) + ((value >> 1) ^ (0u - (value & 1))));
+}
+
+// Compact encoding of an edge list: an 8-byte edge count followed by the
+// Stream VByte coding of three values per edge, each a zigzagged delta:
+// from against the previous from, to against from, and weight against the
+// previous weight. Weight-ordered forests and source-ordered edge lists
+// turn into mostly one- and two-byte values.
+inline size_t edge_codec_max_bytes(size_t n) {
+  return sizeof(uint64_t) + streamvbyte_max_bytes(3 * n);
+}
+
+// Replaces out with the encoding of edges[0, n).
+inline void encode_edges(const edge_t *edges, size_t n,
+                         std::vector<uint8_t> &out) {
+  std::vector<uint32_t> values(3 * n);
+  int32_t prev_from = 0;
+  int32_t prev_weight = 0;
+  for (size_t i = 0; i < n; i++) {
+    values[3 * i] = zigzag_delta(edges[i].from, prev_from);
+    values[3 * i + 1] = zigzag_delta(edges[i].to, edges[i].from);
+    values[3 * i + 2] = zigzag_delta(edges[i].weight, prev_weight);
+    prev_from = edges[i].from;
+    prev_weight = edges[i].weight;
+  }
+  out.resize(edge_codec_max_bytes(n));
+  uint64_t count = n;
+  memcpy(out.data(), &count, sizeof(count));
+  out.resize(sizeof(count) + streamvbyte_encode(values.data(), values.size(),
+                                                out.data() + sizeof(count)));
+}
+
+// Replaces out with the edges encoded in data[0, bytes). Returns false if the
+// buffer is not a complete encoding.
+inline bool decode_edges(const uint8_t *data, size_t bytes,
+                         std::vector<edge_t> &out) {
+  uint64_t count;
+  if (bytes < sizeof(count)) return false;
+  memcpy(&count, data, sizeof(count));
+  if (count > bytes) return false;
+  std::vector<uint32_t> values(3 * count);
+  if (streamvbyte_decode(data + sizeof(count), bytes - sizeof(count),
+                         values.size(), values.data()) == 0 &&
+      count > 0) {
+    return false;
+  }
+  out.resize(count);
+  int32_t from = 0;
+  int32_t weight = 0;
+  for (size_t i = 0; i < count; i++) {
+    from = zigzag_undelta(values[3 * i], from);
+    weight = zigzag_undelta(values[3 * i + 2], weight);
+    out[i] = edge_t(from, zigzag_undelta(values[3 * i + 1], from), weight);
+  }
+  return true;
+}
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef EDGE_SORT_H
+#define EDGE_SORT_H
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "graph.h"
+#include "quick_sort.h"
+#include "radix_sort.h"
+
+#define DEFAULT_SORT_METHOD "std"
+#define SORT_METHOD_HELP "Edge sort: std, quick, radix or radix_keys"
+
+// Backends for sorting edge arrays by weight, selected with --sort.
+// quick is core/quick_sort.h, task-parallel when built with USE_OPENMP=1.
+enum SortMethod { STD_SORT, QUICK_SORT, RADIX_SORT, RADIX_SORT_KEYS };
+
+inline bool parseSortMethod(const std::string &name, SortMethod &method) {
+  if (name == "std") {
+    method = STD_SORT;
+  } else if (name == "quick") {
+    method = QUICK_SORT;
+  } else if (name == "radix") {
+    method = RADIX_SORT;
+  } else if (name == "radix_keys") {
+    method = RADIX_SORT_KEYS;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline void sortEdgesByWeight(edge_t *edges, size_t n, SortMethod method,
+                              uint n_threads = 1) {
+  switch (method) {
+    case QUICK_SORT:
+      parallelQuickSort(edges, n, edge_weight_less, n_threads);
+      break;
+    case RADIX_SORT:
+      radixSortEdges(edges, n, n_threads);
+      break;
+    case RADIX_SORT_KEYS:
+      radixSortEdgesByKey(edges, n, n_threads);
+      break;
+    default:
+      std::sort(edges, edges + n, edge_weight_less);
+      break;
+  }
+}
+
+// Peak bytes per edge while sortEdgesByWeight sorts on one thread: the edges
+// themselves plus the scratch buffers of the out-of-place radix sorts.
+inline size_t sortBytesPerEdge(SortMethod method) {
+  switch (method) {
+    case RADIX_SORT:
+      return 2 * sizeof(edge_t);
+    case RADIX_SORT_KEYS:
+      return 2 * sizeof(edge_t) + 2 * sizeof(uint64_t);
+    default:
+      return sizeof(edge_t);
+  }
+}
+
+// Index-permutation sort for columnar edges: fills order with the indices of
+// weight[0, n) in ascending weight order and leaves the columns untouched.
+// Both radix methods sort (weight, index) keys; std and quick sort the
+// indices directly, comparing through the weight column.
+inline void sortEdgeOrderByWeight(const uintE *weight, size_t n,
+                                  SortMethod method, uint n_threads,
+                                  std::vector<uint32_t> &order) {
+  order.resize(n);
+  if (method == RADIX_SORT || method == RADIX_SORT_KEYS) {
+    radixSortOrderByWeight(weight, n, n_threads, order.data());
+    return;
+  }
+  for (size_t i = 0; i < n; i++) order[i] = i;
+  auto weight_less = [weight](uint32_t a, uint32_t b) {
+    return weight[a] < weight[b];
+  };
+  if (method == QUICK_SORT) {
+    parallelQuickSort(order.data(), n, weight_less, n_threads);
+  } else {
+    std::sort(order.begin(), order.end(), weight_less);
+  }
+}
+
+#endif
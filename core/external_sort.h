@@ -0,0 +1,138 @@
+#ifndef EXTERNAL_SORT_H
+#define EXTERNAL_SORT_H
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "edge_sort.h"
+#include "graph.h"
+
+#define DEFAULT_MEMORY_BUDGET_MB "1024"
+#define DEFAULT_TMP_DIR "/tmp"
+
+// Sorts the edges of reader in runs of at most run_edges and spills every
+// run to its own binary edge-list file in tmp_dir, flagged as sorted by
+// weight. Appends the run paths to run_paths, including those of a failed
+// call so the caller can remove them. Returns false if a run cannot be
+// written.
+inline bool write_sorted_runs(EdgeStreamReader &reader, size_t run_edges,
+                              const std::string &tmp_dir,
+                              SortMethod sort_method,
+                              std::vector<std::string> &run_paths) {
+  std::vector<edge_t> run;
+  while (reader.next(run, run_edges)) {
+    sortEdgesByWeight(run.data(), run.size(), sort_method);
+    std::string path = tmp_dir + "/mst_run_" + std::to_string(getpid()) +
+                       "_" + std::to_string(run_paths.size()) + ".bin";
+    run_paths.push_back(path);
+    BinaryGraphWriter writer(path);
+    writer.write(run.data(), run.size());
+    if (!writer.finish(true)) return false;
+  }
+  return true;
+}
+
+inline void remove_runs(const std::vector<std::string> &run_paths) {
+  for (const auto &path : run_paths) remove(path.c_str());
+}
+
+// Sequential reader of one run written by write_sorted_runs. It reads
+// block_edges edges at a time and always keeps the next block in flight on
+// its own reader thread, started once in open(), so a merge over many runs
+// consumes one block while the disk fills the next instead of stalling on
+// every block boundary.
+class RunReader {
+  std::ifstream input_stream_;
+  uint64_t remaining_;
+  size_t block_edges_;
+  std::vector<edge_t> current_;
+  std::vector<edge_t> next_;
+  size_t pos_;
+  std::thread reader_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  // next_ holds the block after current_; an empty one ends the run. The
+  // reader thread only touches next_ while this is false.
+  bool next_ready_;
+  bool stop_;
+
+  void readBlocks() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this]() { return stop_ || !next_ready_; });
+      if (stop_) return;
+      lock.unlock();
+      next_.resize(std::min<uint64_t>(remaining_, block_edges_));
+      input_stream_.read(reinterpret_cast<char *>(next_.data()),
+                         next_.size() * sizeof(edge_t));
+      next_.resize(input_stream_.gcount() / sizeof(edge_t));
+      remaining_ = next_.empty() ? 0 : remaining_ - next_.size();
+      lock.lock();
+      next_ready_ = true;
+      cv_.notify_all();
+      if (next_.empty()) return;
+    }
+  }
+
+  void advance() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return next_ready_; });
+    current_.swap(next_);
+    pos_ = 0;
+    next_ready_ = false;
+    cv_.notify_all();
+  }
+
+ public:
+  RunReader()
+      : remaining_(0),
+        block_edges_(1),
+        pos_(0),
+        next_ready_(false),
+        stop_(false) {}
+  ~RunReader() {
+    if (!reader_.joinable()) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    reader_.join();
+  }
+
+  RunReader(const RunReader &) = delete;
+  RunReader &operator=(const RunReader &) = delete;
+
+  // Returns false if path is not a binary edge list.
+  bool open(const std::string &path, size_t block_edges) {
+    input_stream_.open(path, std::ios::binary);
+    BinaryGraphHeader header;
+    if (!input_stream_.read(reinterpret_cast<char *>(&header),
+                            sizeof(header)) ||
+        !header.hasMagic() || header.edge_bytes != sizeof(edge_t)) {
+      return false;
+    }
+    input_stream_.seekg(header.header_bytes);
+    remaining_ = header.m;
+    block_edges_ = std::max<size_t>(1, block_edges);
+    reader_ = std::thread(&RunReader::readBlocks, this);
+    advance();
+    return true;
+  }
+
+  bool empty() const { return pos_ == current_.size(); }
+  const edge_t &front() const { return current_[pos_]; }
+
+  void pop() {
+    if (++pos_ == current_.size()) advance();
+  }
+};
+
+#endif
@@ -1,6 +1,21 @@
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <new>
+#include <string>
 #include <vector>
 
+#include "mapped_file.h"
+#include "multiway_merge.h"
+#include "parallel.h"
 #include "utils.h"
 
 typedef struct UndirectWeightedEdge {
@@ -12,32 +27,753 @@ typedef struct UndirectWeightedEdge {
       : from(from_), to(to_), weight(weight_) {}
 } edge_t;
 
+// Orders edges by weight alone. Every sort and merge of edge arrays uses it,
+// so they all agree on the order Kruskal's scan relies on.
+struct EdgeWeightLess {
+  bool operator()(const edge_t &a, const edge_t &b) const {
+    return a.weight < b.weight;
+  }
+};
+const EdgeWeightLess edge_weight_less = EdgeWeightLess();
+
+// Counts the lines in [begin, end), including a last line without a
+// trailing newline.
+inline size_t count_lines(const char *begin, const char *end) {
+  size_t lines = 0;
+  const char *p = begin;
+  while (p < end) {
+    const char *newline =
+        static_cast<const char *>(memchr(p, '\n', end - p));
+    lines++;
+    if (newline == nullptr) break;
+    p = newline + 1;
+  }
+  return lines;
+}
+
+// Parses "from to weight" lines in [begin, end) into out, which must have
+// room for count_lines(begin, end) edges, and returns how many edges were
+// written. Integers are parsed by hand rather than through the locale-aware
+// stream operators. Lines that do not start with three integers are skipped.
+// The weight may be negative. Lines with an id of UINTV_MAX or more, whose
+// vertex count max id + 1 would not fit in uintV, or whose weight does not
+// fit in uintE are skipped too, and counted in rejected.
+inline size_t parse_edge_lines(const char *begin, const char *end,
+                               edge_t *out, uintV &max_vertex_id,
+                               size_t &rejected) {
+  // Values are only tracked up to here; anything larger is out of range.
+  const uint64_t saturated = uint64_t(1) << 32;
+  size_t count = 0;
+  const char *p = begin;
+  while (p < end) {
+    uint64_t values[3];
+    bool negative = false;
+    int k = 0;
+    while (k < 3) {
+      while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+      if (k == 2 && p + 1 < end && *p == '-' &&
+          static_cast<unsigned>(p[1] - '0') <= 9) {
+        negative = true;
+        p++;
+      }
+      if (p == end || static_cast<unsigned>(*p - '0') > 9) break;
+      uint64_t value = 0;
+      while (p < end && static_cast<unsigned>(*p - '0') <= 9) {
+        value = std::min(saturated, value * 10 + (*p++ - '0'));
+      }
+      values[k++] = value;
+    }
+    const char *newline =
+        static_cast<const char *>(memchr(p, '\n', end - p));
+    p = (newline == nullptr) ? end : newline + 1;
+    if (k < 3) continue;
+    uint64_t max_weight = negative ? uint64_t(INT32_MAX) + 1 : INT32_MAX;
+    if (values[0] >= uint64_t(UINTV_MAX) || values[1] >= uint64_t(UINTV_MAX) ||
+        values[2] > max_weight) {
+      rejected++;
+      continue;
+    }
+
+    uintV from = values[0];
+    uintV to = values[1];
+    uintE weight = negative ? uintE(-int64_t(values[2])) : uintE(values[2]);
+    new (out + count) edge_t(from, to, weight);
+    count++;
+    if (from > max_vertex_id) max_vertex_id = from;
+    if (to > max_vertex_id) max_vertex_id = to;
+  }
+  return count;
+}
+
+// Warns about the lines parse_edge_lines rejected while loading
+// input_file_path, if there were any.
+inline void report_rejected_lines(const std::string &input_file_path,
+                                  size_t rejected) {
+  if (rejected == 0) return;
+  std::cout << "Input File: " << input_file_path << ": skipped " << rejected
+            << " lines with out-of-range values" << std::endl;
+}
+
+// Edge storage for Graph. Behaves like a fixed-size std::vector<edge_t>, but
+// allocate() leaves the buffer uninitialized so loaders can fill it in
+// parallel without a serial zero-fill pass first, and adopt() uses the edges
+// of a mapped file in place.
+class EdgeArray {
+  edge_t *data_;
+  size_t size_;
+  MappedFile mapping_;
+
+  void release() {
+    if (mapping_.data() == nullptr) {
+      ::operator delete(data_);
+    }
+    mapping_ = MappedFile();
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+ public:
+  EdgeArray() : data_(nullptr), size_(0) {}
+  ~EdgeArray() { release(); }
+
+  EdgeArray(const EdgeArray &) = delete;
+  EdgeArray &operator=(const EdgeArray &) = delete;
+
+  void allocate(size_t n) {
+    release();
+    data_ = static_cast<edge_t *>(::operator new(n * sizeof(edge_t)));
+    size_ = n;
+  }
+
+  // Takes ownership of file and views its n edges starting at byte offset.
+  // Writes (e.g. sorting) only touch private copy-on-write pages.
+  void adopt(MappedFile &&file, size_t offset, size_t n) {
+    release();
+    mapping_ = std::move(file);
+    data_ = reinterpret_cast<edge_t *>(mapping_.data() + offset);
+    size_ = n;
+  }
+
+  // Drops the edges past the first n.
+  void truncate(size_t n) {
+    if (n < size_) size_ = n;
+  }
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  edge_t *data() { return data_; }
+  const edge_t *data() const { return data_; }
+  edge_t *begin() { return data_; }
+  edge_t *end() { return data_ + size_; }
+  const edge_t *begin() const { return data_; }
+  const edge_t *end() const { return data_ + size_; }
+  edge_t &operator[](size_t i) { return data_[i]; }
+  const edge_t &operator[](size_t i) const { return data_[i]; }
+};
+
+#define EDGE_COLUMN_ALIGNMENT 64
+
+// Uninitialized fixed-size array aligned to a cache line, so column scans
+// start on a line boundary and vectorize without a peeled prologue.
+template <class T>
+class AlignedArray {
+  T *data_;
+  size_t size_;
+
+ public:
+  AlignedArray() : data_(nullptr), size_(0) {}
+  ~AlignedArray() { free(data_); }
+
+  AlignedArray(const AlignedArray &) = delete;
+  AlignedArray &operator=(const AlignedArray &) = delete;
+
+  void allocate(size_t n) {
+    free(data_);
+    data_ = nullptr;
+    size_ = n;
+    if (n == 0) return;
+    size_t bytes = (n * sizeof(T) + EDGE_COLUMN_ALIGNMENT - 1) /
+                   EDGE_COLUMN_ALIGNMENT * EDGE_COLUMN_ALIGNMENT;
+    if (posix_memalign(reinterpret_cast<void **>(&data_),
+                       EDGE_COLUMN_ALIGNMENT, bytes) != 0) {
+      throw std::bad_alloc();
+    }
+  }
+
+  size_t size() const { return size_; }
+  T *data() { return data_; }
+  const T *data() const { return data_; }
+  T &operator[](size_t i) { return data_[i]; }
+  const T &operator[](size_t i) const { return data_[i]; }
+};
+
+// Structure-of-arrays copy of an edge list: from[i], to[i] and weight[i]
+// describe edge i. Passes that only look at weights read a dense uintE
+// column instead of striding over 12-byte records.
+struct EdgeColumns {
+  AlignedArray<uintV> from;
+  AlignedArray<uintV> to;
+  AlignedArray<uintE> weight;
+
+  size_t size() const { return weight.size(); }
+  edge_t edge(size_t i) const { return edge_t(from[i], to[i], weight[i]); }
+
+  void build(const EdgeArray &edges, uint n_threads) {
+    from.allocate(edges.size());
+    to.allocate(edges.size());
+    weight.allocate(edges.size());
+    parallel_for_blocks(
+        n_threads, edges.size(), [&](uint, size_t start, size_t end) {
+          for (size_t i = start; i < end; i++) {
+            from[i] = edges[i].from;
+            to[i] = edges[i].to;
+            weight[i] = edges[i].weight;
+          }
+        });
+  }
+};
+
+// Edge storage an engine works on: the edge_t records of Graph::edges, or
+// the columns of Graph::getColumns().
+enum EdgeLayout { AOS_LAYOUT, SOA_LAYOUT };
+
+#define DEFAULT_EDGE_LAYOUT "aos"
+#define EDGE_LAYOUT_HELP "Edge storage: aos (edge records) or soa (columns)"
+
+inline bool parseEdgeLayout(const std::string &name, EdgeLayout &layout) {
+  if (name == "aos") {
+    layout = AOS_LAYOUT;
+  } else if (name == "soa") {
+    layout = SOA_LAYOUT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#define BINARY_GRAPH_MAGIC "MSTEDGES"
+#define BINARY_GRAPH_VERSION 1
+#define BINARY_GRAPH_SORTED_BY_WEIGHT 0x1
+
+// Header of the binary edge-list format. The payload that follows is m
+// packed edge_t records in native byte order, starting at header_bytes.
+struct BinaryGraphHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t header_bytes;
+  uint32_t id_bytes;
+  uint32_t weight_bytes;
+  uint32_t edge_bytes;
+  uint32_t flags;
+  uint64_t n;
+  uint64_t m;
+  uint8_t reserved[16];
+
+  BinaryGraphHeader()
+      : version(BINARY_GRAPH_VERSION),
+        header_bytes(sizeof(BinaryGraphHeader)),
+        id_bytes(sizeof(uintV)),
+        weight_bytes(sizeof(uintE)),
+        edge_bytes(sizeof(edge_t)),
+        flags(0),
+        n(0),
+        m(0) {
+    memcpy(magic, BINARY_GRAPH_MAGIC, sizeof(magic));
+    memset(reserved, 0, sizeof(reserved));
+  }
+
+  bool hasMagic() const {
+    return memcmp(magic, BINARY_GRAPH_MAGIC, sizeof(magic)) == 0;
+  }
+
+  // Whether this build can read the payload of a file of file_size bytes
+  // with this header: same record layout, a header_bytes that covers the
+  // header and keeps the records aligned, m records inside the file, and
+  // vertex ids that fit in uintV. All bounds are checked without overflow.
+  bool isSupported(uint64_t file_size) const {
+    return hasMagic() && version == BINARY_GRAPH_VERSION &&
+           id_bytes == sizeof(uintV) && weight_bytes == sizeof(uintE) &&
+           edge_bytes == sizeof(edge_t) &&
+           header_bytes >= sizeof(BinaryGraphHeader) &&
+           header_bytes % alignof(edge_t) == 0 && header_bytes <= file_size &&
+           m <= (file_size - header_bytes) / sizeof(edge_t) &&
+           n <= uint64_t(UINTV_MAX);
+  }
+};
+
+// Whether both endpoints of every edge in edges[0, m) lie in [0, n).
+inline bool edge_ids_below(const edge_t *edges, size_t m, uint64_t n) {
+  for (size_t i = 0; i < m; i++) {
+    if (edges[i].from < 0 || uint64_t(edges[i].from) >= n ||
+        edges[i].to < 0 || uint64_t(edges[i].to) >= n) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Streams edges into a binary edge-list file. The header is written last, so
+// callers do not need to know n or m up front.
+class BinaryGraphWriter {
+  std::ofstream output_stream_;
+  BinaryGraphHeader header_;
+  uintV max_vertex_id_;
+
+ public:
+  explicit BinaryGraphWriter(const std::string &output_file_path)
+      : output_stream_(output_file_path, std::ios::binary),
+        max_vertex_id_(0) {
+    output_stream_.write(reinterpret_cast<const char *>(&header_),
+                         sizeof(header_));
+  }
+
+  void write(const edge_t *edges, size_t count) {
+    output_stream_.write(reinterpret_cast<const char *>(edges),
+                         count * sizeof(edge_t));
+    for (size_t i = 0; i < count; i++) {
+      max_vertex_id_ = std::max(max_vertex_id_, edges[i].from);
+      max_vertex_id_ = std::max(max_vertex_id_, edges[i].to);
+    }
+    header_.m += count;
+  }
+
+  void write(const edge_t &edge) { write(&edge, 1); }
+
+  // Fills in the header and closes the file. n defaults to max vertex id + 1.
+  // Returns false if any write failed.
+  bool finish(bool sorted_by_weight, uint64_t n = 0) {
+    header_.n = (n == 0) ? uint64_t(max_vertex_id_) + 1 : n;
+    header_.flags = sorted_by_weight ? BINARY_GRAPH_SORTED_BY_WEIGHT : 0;
+    output_stream_.seekp(0);
+    output_stream_.write(reinterpret_cast<const char *>(&header_),
+                         sizeof(header_));
+    output_stream_.close();
+    return !output_stream_.fail();
+  }
+};
+
+#define EDGE_STREAM_BUFFER_BYTES (4 << 20)
+// Edges per block of Graph::readGraphSorted.
+#define EDGE_PIPELINE_BLOCK_EDGES (1 << 18)
+
+// Reads an edge list of either format a bounded chunk at a time, for engines
+// that never hold the whole graph. Binary payloads are read record by
+// record; text is read in buffer-sized blocks and parsed with
+// parse_edge_lines, a line left incomplete at the end of a block being
+// carried over to the next one.
+class EdgeStreamReader {
+  std::ifstream input_stream_;
+  BinaryGraphHeader header_;
+  bool binary_;
+  uint64_t remaining_;
+  std::vector<char> buffer_;
+  size_t begin_;
+  size_t end_;
+  bool eof_;
+  uintV max_vertex_id_;
+  size_t rejected_;
+  bool bad_edge_ids_;
+
+  // Moves the unparsed bytes to the front of buffer_ (growing it when a
+  // single line fills it) and reads more after them.
+  void refill() {
+    memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+    end_ -= begin_;
+    begin_ = 0;
+    if (end_ == buffer_.size()) buffer_.resize(2 * buffer_.size());
+    input_stream_.read(buffer_.data() + end_, buffer_.size() - end_);
+    end_ += input_stream_.gcount();
+    if (input_stream_.gcount() == 0) eof_ = true;
+  }
+
+  void nextText(std::vector<edge_t> &chunk, size_t max_edges) {
+    while (chunk.size() < max_edges) {
+      const char *text = buffer_.data();
+      size_t lines = 0;
+      size_t pos = begin_;
+      while (lines < max_edges - chunk.size()) {
+        const char *newline = static_cast<const char *>(
+            memchr(text + pos, '\n', end_ - pos));
+        if (newline == nullptr) break;
+        pos = newline - text + 1;
+        lines++;
+      }
+      if (lines == 0 && eof_) {
+        // The last line, which has no trailing newline.
+        if (begin_ == end_) return;
+        pos = end_;
+        lines = 1;
+      }
+      if (lines == 0) {
+        refill();
+        continue;
+      }
+      size_t count = chunk.size();
+      chunk.resize(count + lines);
+      count += parse_edge_lines(text + begin_, text + pos,
+                                chunk.data() + count, max_vertex_id_,
+                                rejected_);
+      chunk.resize(count);
+      begin_ = pos;
+    }
+  }
+
+ public:
+  EdgeStreamReader()
+      : binary_(false),
+        remaining_(0),
+        begin_(0),
+        end_(0),
+        eof_(false),
+        max_vertex_id_(0),
+        rejected_(0),
+        bad_edge_ids_(false) {}
+
+  // Returns false if the file cannot be opened or has an unsupported binary
+  // header.
+  bool open(const std::string &input_file_path) {
+    input_stream_.open(input_file_path, std::ios::binary);
+    if (!input_stream_) return false;
+    binary_ = input_stream_.read(reinterpret_cast<char *>(&header_),
+                                 sizeof(header_)) &&
+              header_.hasMagic();
+    if (binary_) {
+      input_stream_.seekg(0, std::ios::end);
+      if (!header_.isSupported(input_stream_.tellg())) return false;
+      input_stream_.seekg(header_.header_bytes);
+      remaining_ = header_.m;
+      return true;
+    }
+    input_stream_.clear();
+    input_stream_.seekg(0);
+    buffer_.resize(EDGE_STREAM_BUFFER_BYTES);
+    return true;
+  }
+
+  // Replaces chunk with the next edges, at most max_edges of them. Returns
+  // false once the input is exhausted, or at the first binary chunk with an
+  // edge id outside [0, n), which badEdgeIds() then reports.
+  bool next(std::vector<edge_t> &chunk, size_t max_edges) {
+    chunk.clear();
+    if (bad_edge_ids_) return false;
+    if (binary_) {
+      chunk.resize(std::min<uint64_t>(remaining_, max_edges));
+      input_stream_.read(reinterpret_cast<char *>(chunk.data()),
+                         chunk.size() * sizeof(edge_t));
+      chunk.resize(input_stream_.gcount() / sizeof(edge_t));
+      remaining_ = chunk.empty() ? 0 : remaining_ - chunk.size();
+      if (!edge_ids_below(chunk.data(), chunk.size(), header_.n)) {
+        bad_edge_ids_ = true;
+        chunk.clear();
+      }
+    } else {
+      nextText(chunk, max_edges);
+    }
+    return !chunk.empty();
+  }
+
+  // Number of vertices: the header's for binary input, otherwise one more
+  // than the largest id read so far.
+  uintV numVertices() const {
+    if (binary_) return header_.n;
+    return max_vertex_id_ + 1;
+  }
+
+  // Whether next() stopped at a binary edge whose id is negative or not
+  // below the header's n; the engines would index their UnionFind with it.
+  bool badEdgeIds() const { return bad_edge_ids_; }
+
+  // Text lines skipped so far for out-of-range values.
+  size_t rejectedLines() const { return rejected_; }
+
+  // Whether the edges come in weight order, which only a binary header can
+  // promise.
+  bool sortedByWeight() const {
+    return binary_ && (header_.flags & BINARY_GRAPH_SORTED_BY_WEIGHT);
+  }
+};
+
+// Compressed sparse row adjacency of an undirected graph. Every edge appears
+// in the rows of both of its endpoints: the neighbors of v are
+// neighbors[offsets[v] .. offsets[v + 1]), with matching weights.
+struct CSRGraph {
+  std::vector<uint64_t> offsets;
+  std::vector<uintV> neighbors;
+  std::vector<uintE> weights;
+
+  uintV numVertices() const { return offsets.size() - 1; }
+  uint64_t degree(uintV v) const { return offsets[v + 1] - offsets[v]; }
+
+  // Builds the rows on n_threads threads: a counting pass tallies degrees with
+  // atomic increments, a prefix sum turns them into offsets, and a scatter
+  // pass claims slots in each row through per-vertex atomic cursors.
+  void build(const EdgeArray &edges, uintV n, uint n_threads) {
+    std::vector<std::atomic<uint64_t>> cursor(n);
+    parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+      for (size_t v = start; v < end; v++) {
+        cursor[v].store(0, std::memory_order_relaxed);
+      }
+    });
+    parallel_for_blocks(
+        n_threads, edges.size(), [&](uint, size_t start, size_t end) {
+          for (size_t i = start; i < end; i++) {
+            cursor[edges[i].from].fetch_add(1, std::memory_order_relaxed);
+            cursor[edges[i].to].fetch_add(1, std::memory_order_relaxed);
+          }
+        });
+
+    std::vector<uint64_t> degrees(n);
+    parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+      for (size_t v = start; v < end; v++) {
+        degrees[v] = cursor[v].load(std::memory_order_relaxed);
+      }
+    });
+    offsets.resize(uint64_t(n) + 1);
+    parallel_exclusive_scan(n_threads, degrees.data(), offsets.data(), n);
+    parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+      for (size_t v = start; v < end; v++) {
+        cursor[v].store(offsets[v], std::memory_order_relaxed);
+      }
+    });
+
+    neighbors.resize(offsets[n]);
+    weights.resize(offsets[n]);
+    parallel_for_blocks(
+        n_threads, edges.size(), [&](uint, size_t start, size_t end) {
+          for (size_t i = start; i < end; i++) {
+            const edge_t &edge = edges[i];
+            uint64_t slot =
+                cursor[edge.from].fetch_add(1, std::memory_order_relaxed);
+            neighbors[slot] = edge.to;
+            weights[slot] = edge.weight;
+            slot = cursor[edge.to].fetch_add(1, std::memory_order_relaxed);
+            neighbors[slot] = edge.from;
+            weights[slot] = edge.weight;
+          }
+        });
+  }
+};
+
 class Graph {
+  std::unique_ptr<CSRGraph> csr_;
+  std::unique_ptr<EdgeColumns> columns_;
+
  public:
   uintV n_;
   uintE m_;
-  std::vector<edge_t> edges;
+  EdgeArray edges;
+  bool sorted_by_weight_ = false;
+
+  // CSR adjacency of edges, built on first use. Reloading the graph drops it.
+  const CSRGraph &getCSR(uint n_threads = getNumberOfCores()) {
+    if (!csr_) {
+      csr_.reset(new CSRGraph());
+      csr_->build(edges, n_, n_threads);
+    }
+    return *csr_;
+  }
+
+  // Structure-of-arrays copy of edges, built on first use. Like the CSR it
+  // is a snapshot: reloading the graph drops it, and later changes to edges
+  // (e.g. sorting them) are not reflected.
+  const EdgeColumns &getColumns(uint n_threads = getNumberOfCores()) {
+    if (!columns_) {
+      columns_.reset(new EdgeColumns());
+      columns_->build(edges, n_threads);
+    }
+    return *columns_;
+  }
+
+  // Loads either format, telling them apart by the binary header magic.
+  void readGraph(std::string input_file_path) {
+    std::ifstream input_stream(input_file_path, std::ios::binary);
+    BinaryGraphHeader header;
+    if (input_stream.read(reinterpret_cast<char *>(&header), sizeof(header)) &&
+        header.hasMagic()) {
+      input_stream.close();
+      readGraphFromBinaryFile(input_file_path);
+    } else {
+      input_stream.close();
+      readGraphFromTextFile(input_file_path);
+    }
+  }
 
-  void readGraphFromTextFile(std::string input_file_path) {
-    std::ifstream input_stream(input_file_path);
-    if (!input_stream) {
+  // Maps a binary edge list and uses its payload as edges without parsing or
+  // copying it. The header must fit n and m in uintV and uintE and every
+  // edge id must be below n, since the engines index their UnionFind with
+  // them unchecked.
+  void readGraphFromBinaryFile(std::string input_file_path) {
+    MappedFile input_file;
+    if (!input_file.open(input_file_path)) {
       std::cout << "Input File: " << input_file_path
                 << " does not exist. Terminating" << std::endl;
       exit(2);
     }
+    BinaryGraphHeader header;
+    if (input_file.size() < sizeof(header)) {
+      std::cout << "Input File: " << input_file_path
+                << " is not a binary edge list. Terminating" << std::endl;
+      exit(2);
+    }
+    memcpy(&header, input_file.data(), sizeof(header));
+    if (!header.isSupported(input_file.size()) ||
+        header.m > uint64_t(UINTE_MAX) ||
+        !edge_ids_below(reinterpret_cast<const edge_t *>(
+                            input_file.data() + header.header_bytes),
+                        header.m, header.n)) {
+      std::cout << "Input File: " << input_file_path
+                << " has an unsupported binary header. Terminating"
+                << std::endl;
+      exit(2);
+    }
 
-    uintV from, to;
-    uintV max_vertex_id = 0;
-    uintE weight;
-    while (input_stream >> from >> to >> weight) {
-      edges.emplace_back(from, to, weight);
-      if (from > max_vertex_id) max_vertex_id = from;
-      if (to > max_vertex_id) max_vertex_id = to;
+    csr_.reset();
+    columns_.reset();
+    edges.adopt(std::move(input_file), header.header_bytes, header.m);
+    n_ = header.n;
+    m_ = header.m;
+    sorted_by_weight_ = header.flags & BINARY_GRAPH_SORTED_BY_WEIGHT;
+  }
+
+  // Loads either format with parsing and sorting overlapped. This thread
+  // reads block_edges edges at a time through an EdgeStreamReader and hands
+  // every block to a pool task that runs sort_block(block, size) on it while
+  // the next block is parsed; a parallel_multiway_merge of the sorted blocks
+  // then fills edges. The critical path is roughly the longer of the reading
+  // and the sorting rather than their sum, at the cost of holding the edges
+  // twice during the merge. Leaves the edges sorted by weight.
+  template <class SortBlock>
+  void readGraphSorted(std::string input_file_path, uint n_threads,
+                       SortBlock sort_block,
+                       size_t block_edges = EDGE_PIPELINE_BLOCK_EDGES) {
+    EdgeStreamReader reader;
+    if (!reader.open(input_file_path)) {
+      std::cout << "Input File: " << input_file_path
+                << " cannot be read. Terminating" << std::endl;
+      exit(2);
+    }
+    std::unique_ptr<ThreadPool> own_pool;
+    if (ThreadPool::current() == nullptr) {
+      own_pool.reset(new ThreadPool(n_threads));
+    }
+    ThreadPool &pool = own_pool ? *own_pool : *ThreadPool::current();
+
+    // A deque keeps the blocks in place while the sort tasks work on them.
+    std::deque<std::vector<edge_t>> blocks;
+    size_t num_edges = 0;
+    {
+      TaskGroup group(pool);
+      while (true) {
+        blocks.emplace_back();
+        std::vector<edge_t> *block = &blocks.back();
+        if (!reader.next(*block, block_edges)) {
+          blocks.pop_back();
+          break;
+        }
+        num_edges += block->size();
+        if (!reader.sortedByWeight()) {
+          group.spawn([block, &sort_block]() {
+            sort_block(block->data(), block->size());
+          });
+        }
+      }
+      group.wait();
+    }
+    if (reader.badEdgeIds()) {
+      std::cout << "Input File: " << input_file_path
+                << " has an unsupported binary header. Terminating"
+                << std::endl;
+      exit(2);
+    }
+
+    std::vector<std::pair<const edge_t *, const edge_t *>> runs;
+    for (const auto &block : blocks) {
+      runs.emplace_back(block.data(), block.data() + block.size());
+    }
+    csr_.reset();
+    columns_.reset();
+    edges.allocate(num_edges);
+    parallel_multiway_merge(runs, edges.data(), edge_weight_less, n_threads);
+
+    report_rejected_lines(input_file_path, reader.rejectedLines());
+    n_ = reader.numVertices();
+    m_ = num_edges;
+    sorted_by_weight_ = true;
+  }
+
+  bool writeGraphToBinaryFile(std::string output_file_path) const {
+    BinaryGraphWriter writer(output_file_path);
+    writer.write(edges.data(), edges.size());
+    return writer.finish(sorted_by_weight_, n_);
+  }
+
+  // Memory-maps the edge list and parses it on n_threads threads. The file is
+  // cut into newline-aligned chunks; a counting pass sizes each chunk's slice
+  // of edges, then every thread parses its chunk straight into that slice.
+  void readGraphFromTextFile(std::string input_file_path,
+                             uint n_threads = getNumberOfCores()) {
+    MappedFile input_file;
+    if (!input_file.open(input_file_path)) {
+      std::cout << "Input File: " << input_file_path
+                << " does not exist. Terminating" << std::endl;
+      exit(2);
+    }
+    const char *text = input_file.data();
+    size_t length = input_file.size();
+    if (n_threads == 0) n_threads = 1;
+
+    std::vector<size_t> chunk_start(n_threads + 1, length);
+    chunk_start[0] = 0;
+    for (uint i = 1; i < n_threads; i++) {
+      size_t pos = std::max(length / n_threads * i, chunk_start[i - 1]);
+      const char *newline =
+          static_cast<const char *>(memchr(text + pos, '\n', length - pos));
+      chunk_start[i] = (newline == nullptr) ? length : newline - text + 1;
+    }
+
+    std::vector<size_t> chunk_lines(n_threads);
+    parallel_tasks(n_threads, [&](uint i) {
+      chunk_lines[i] =
+          count_lines(text + chunk_start[i], text + chunk_start[i + 1]);
+    });
+    std::vector<size_t> chunk_offset(n_threads + 1, 0);
+    for (uint i = 0; i < n_threads; i++) {
+      chunk_offset[i + 1] = chunk_offset[i] + chunk_lines[i];
     }
 
-    input_stream.close();
+    csr_.reset();
+    columns_.reset();
+    edges.allocate(chunk_offset[n_threads]);
+    std::vector<size_t> chunk_edges(n_threads);
+    std::vector<uintV> chunk_max_vertex_id(n_threads, 0);
+    std::vector<size_t> chunk_rejected(n_threads, 0);
+    parallel_tasks(n_threads, [&](uint i) {
+      chunk_edges[i] = parse_edge_lines(
+          text + chunk_start[i], text + chunk_start[i + 1],
+          edges.data() + chunk_offset[i], chunk_max_vertex_id[i],
+          chunk_rejected[i]);
+    });
+
+    // Blank or malformed lines leave gaps behind a chunk's edges; close them.
+    size_t num_edges = 0;
+    uintV max_vertex_id = 0;
+    size_t rejected = 0;
+    for (uint i = 0; i < n_threads; i++) {
+      rejected += chunk_rejected[i];
+      if (num_edges != chunk_offset[i]) {
+        memmove(edges.data() + num_edges, edges.data() + chunk_offset[i],
+                chunk_edges[i] * sizeof(edge_t));
+      }
+      num_edges += chunk_edges[i];
+      max_vertex_id = std::max(max_vertex_id, chunk_max_vertex_id[i]);
+    }
+    edges.truncate(num_edges);
+    report_rejected_lines(input_file_path, rejected);
 
     n_ = max_vertex_id + 1;
     m_ = edges.size();
+    sorted_by_weight_ = false;
   }
 };
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+// Private, copy-on-write mapping of a whole file. Pages are shared with the
+// page cache until written, so loaders can read (or sort) the contents in
+// place without copying them into the heap first.
+class MappedFile {
+  char *data_;
+  size_t size_;
+
+  void release() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+ public:
+  MappedFile() : data_(nullptr), size_(0) {}
+  ~MappedFile() { release(); }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  MappedFile(MappedFile &&other) : data_(other.data_), size_(other.size_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+  }
+  MappedFile &operator=(MappedFile &&other) {
+    if (this != &other) {
+      release();
+      data_ = other.data_;
+      size_ = other.size_;
+      other.data_ = nullptr;
+      other.size_ = 0;
+    }
+    return *this;
+  }
+
+  // Returns false if the file cannot be opened or mapped. An empty file maps
+  // successfully to an empty range.
+  bool open(const std::string &path) {
+    release();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0) {
+      close(fd);
+      return false;
+    }
+    size_t length = file_stat.st_size;
+    if (length > 0) {
+      void *addr = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                        fd, 0);
+      if (addr == MAP_FAILED) {
+        close(fd);
+        return false;
+      }
+      madvise(addr, length, MADV_SEQUENTIAL);
+      data_ = static_cast<char *>(addr);
+      size_ = length;
+    }
+    close(fd);
+    return true;
+  }
+
+  char *data() const { return data_; }
+  size_t size() const { return size_; }
+};
+
+#endif
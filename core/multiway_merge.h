@@ -0,0 +1,169 @@
+#ifndef MULTIWAY_MERGE_H
+#define MULTIWAY_MERGE_H
+
+#include <stdlib.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "parallel.h"
+
+// Tournament tree of losers over k sorted sources. Every internal node keeps
+// the source that lost the match played there and the root slot keeps the
+// overall winner, so replacing the winner's key replays a single
+// leaf-to-root path of log2 k comparisons, one per level, against the
+// losers stored on it; a binary heap needs two per level to pick a child.
+// Exhausted sources lose every match. Ties go to the lower source index,
+// which keeps merges stable.
+template <class T, class Less>
+class LoserTree {
+  size_t k_;
+  std::vector<size_t> tree_;
+  std::vector<T> keys_;
+  std::vector<bool> exhausted_;
+  Less less_;
+
+  bool beats(size_t a, size_t b) const {
+    if (exhausted_[a]) return false;
+    if (exhausted_[b]) return true;
+    if (less_(keys_[a], keys_[b])) return true;
+    return !less_(keys_[b], keys_[a]) && a < b;
+  }
+
+  void replay(size_t source) {
+    for (size_t node = (k_ + source) / 2; node > 0; node /= 2) {
+      if (beats(tree_[node], source)) std::swap(tree_[node], source);
+    }
+    tree_[0] = source;
+  }
+
+ public:
+  // Starts with every source exhausted; give each its first key with
+  // setKey() and then call build().
+  LoserTree(size_t k, Less less = Less())
+      : k_(std::max<size_t>(1, k)),
+        tree_(k_, 0),
+        keys_(k_),
+        exhausted_(k_, true),
+        less_(less) {}
+
+  void setKey(size_t source, const T &key) {
+    keys_[source] = key;
+    exhausted_[source] = false;
+  }
+
+  // Plays every match bottom-up. Leaves sit at k..2k-1, so any k works.
+  void build() {
+    std::vector<size_t> winners(2 * k_);
+    for (size_t i = 0; i < k_; i++) winners[k_ + i] = i;
+    for (size_t node = k_ - 1; node > 0; node--) {
+      size_t a = winners[2 * node];
+      size_t b = winners[2 * node + 1];
+      if (beats(a, b)) {
+        winners[node] = a;
+        tree_[node] = b;
+      } else {
+        winners[node] = b;
+        tree_[node] = a;
+      }
+    }
+    tree_[0] = k_ == 1 ? 0 : winners[1];
+  }
+
+  bool empty() const { return exhausted_[tree_[0]]; }
+  size_t winner() const { return tree_[0]; }
+  const T &winnerKey() const { return keys_[tree_[0]]; }
+
+  // Gives the winning source its next key.
+  void replaceWinner(const T &key) {
+    keys_[tree_[0]] = key;
+    replay(tree_[0]);
+  }
+
+  // Marks the winning source as exhausted.
+  void exhaustWinner() {
+    exhausted_[tree_[0]] = true;
+    replay(tree_[0]);
+  }
+};
+
+// Merges the sorted ranges runs[i] = [first, second) into out, which needs
+// room for all of them, with a LoserTree.
+template <class T, class Less>
+void multiway_merge(const std::vector<std::pair<const T *, const T *>> &runs,
+                    T *out, Less less) {
+  std::vector<std::pair<const T *, const T *>> cursor(runs);
+  LoserTree<T, Less> tree(cursor.size(), less);
+  for (size_t i = 0; i < cursor.size(); i++) {
+    if (cursor[i].first != cursor[i].second) tree.setKey(i, *cursor[i].first);
+  }
+  tree.build();
+  while (!tree.empty()) {
+    size_t i = tree.winner();
+    *out++ = *cursor[i].first++;
+    if (cursor[i].first != cursor[i].second) {
+      tree.replaceWinner(*cursor[i].first);
+    } else {
+      tree.exhaustWinner();
+    }
+  }
+}
+
+// multiway_merge on n_threads parallel_tasks. Splitters picked from an even
+// sample of every run cut each run at its lower_bound of every splitter;
+// group g then holds exactly the elements between splitters g - 1 and g,
+// so the groups merge independently into consecutive slices of out. Long
+// stretches of equal keys can unbalance the groups but never the order.
+template <class T, class Less>
+void parallel_multiway_merge(
+    const std::vector<std::pair<const T *, const T *>> &runs, T *out,
+    Less less, uint n_threads) {
+  if (n_threads <= 1 || runs.size() <= 1) {
+    multiway_merge(runs, out, less);
+    return;
+  }
+  std::vector<T> sample;
+  uint samples_per_run = 4 * n_threads;
+  for (const auto &run : runs) {
+    size_t length = run.second - run.first;
+    if (length == 0) continue;
+    for (uint j = 0; j < samples_per_run; j++) {
+      sample.push_back(run.first[length * j / samples_per_run]);
+    }
+  }
+  if (sample.empty()) return;
+  std::sort(sample.begin(), sample.end(), less);
+
+  // bounds[g * k + r] is where group g starts in run r.
+  size_t k = runs.size();
+  std::vector<const T *> bounds((n_threads + 1) * k);
+  std::vector<size_t> offset(n_threads + 1, 0);
+  for (size_t r = 0; r < k; r++) {
+    bounds[r] = runs[r].first;
+    bounds[n_threads * k + r] = runs[r].second;
+  }
+  for (uint g = 1; g < n_threads; g++) {
+    const T &splitter = sample[sample.size() * g / n_threads];
+    for (size_t r = 0; r < k; r++) {
+      bounds[g * k + r] = std::lower_bound(bounds[(g - 1) * k + r],
+                                           runs[r].second, splitter, less);
+    }
+  }
+  for (uint g = 0; g < n_threads; g++) {
+    offset[g + 1] = offset[g];
+    for (size_t r = 0; r < k; r++) {
+      offset[g + 1] += bounds[(g + 1) * k + r] - bounds[g * k + r];
+    }
+  }
+
+  parallel_tasks(n_threads, [&](uint g) {
+    std::vector<std::pair<const T *, const T *>> group(k);
+    for (size_t r = 0; r < k; r++) {
+      group[r] = std::make_pair(bounds[g * k + r], bounds[(g + 1) * k + r]);
+    }
+    multiway_merge(group, out + offset[g], less);
+  });
+}
+
+#endif
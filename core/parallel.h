@@ -0,0 +1,115 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+// Number of hardware threads, or 1 when it cannot be detected.
+inline uint getNumberOfCores() {
+  uint cores = std::thread::hardware_concurrency();
+  return cores == 0 ? 1 : cores;
+}
+
+// Runs f(thread_id) on n_threads threads and waits for all of them.
+// Thread 0 runs on the calling thread. The threads are always dedicated, so
+// f may synchronize with the others (e.g. through a barrier).
+template <class F>
+void parallel_run(uint n_threads, F f) {
+  std::vector<std::thread> threads;
+  for (uint i = 1; i < n_threads; i++) {
+    threads.emplace_back(f, i);
+  }
+  f(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+// Runs f(i) for every i in [0, n) as independent tasks and waits for them.
+// The tasks run on ThreadPool::current() when one is installed, so idle
+// workers can steal them; otherwise each gets its own std::thread.
+template <class F>
+void parallel_tasks(uint n, F f) {
+  ThreadPool *pool = ThreadPool::current();
+  if (pool == nullptr) {
+    parallel_run(n, f);
+    return;
+  }
+  TaskGroup group(*pool);
+  for (uint i = 1; i < n; i++) {
+    group.spawn([&f, i]() { f(i); });
+  }
+  if (n > 0) f(0);
+  group.wait();
+}
+
+// Splits [0, n) into n_threads contiguous blocks, the first n % n_threads of
+// them one element larger, and runs f(block_id, start, end) on each block as
+// a parallel_tasks task.
+template <class F>
+void parallel_for_blocks(uint n_threads, size_t n, F f) {
+  size_t base = n / n_threads;
+  size_t remainder = n % n_threads;
+  parallel_tasks(n_threads, [&](uint i) {
+    size_t start = i * base + std::min<size_t>(i, remainder);
+    size_t end = start + base + (i < remainder ? 1 : 0);
+    f(i, start, end);
+  });
+}
+
+// Number of distinct worker ids parallel_for may pass to f.
+inline uint parallel_workers(uint n_threads) {
+  ThreadPool *pool = ThreadPool::current();
+  return pool == nullptr ? n_threads : std::max(n_threads, pool->numThreads());
+}
+
+// Runs f(worker_id, start, end) over disjoint subranges covering [0, n).
+// On ThreadPool::current() the ranges come from ThreadPool::parallelFor, so
+// their number and size adapt to how fast the workers drain them, and
+// worker_id is the pool index of the thread running the range. Calls with
+// the same worker_id never overlap. Without a pool it is parallel_for_blocks.
+// Callers that keep per-block state indexed by block should use
+// parallel_for_blocks instead.
+template <class F>
+void parallel_for(uint n_threads, size_t n, F f) {
+  ThreadPool *pool = ThreadPool::current();
+  if (pool == nullptr) {
+    parallel_for_blocks(n_threads, n, f);
+    return;
+  }
+  pool->parallelFor(0, n, [pool, &f](size_t start, size_t end) {
+    f(pool->workerIndex(), start, end);
+  });
+}
+
+// Writes the exclusive prefix sums of in[0, n) to out[0, n] (out[n] holds the
+// total) using a per-block sum pass, a scan over the block sums, and a
+// per-block local scan. in and out may alias.
+template <class InT, class OutT>
+void parallel_exclusive_scan(uint n_threads, const InT *in, OutT *out,
+                             size_t n) {
+  std::vector<OutT> block_sum(n_threads + 1, 0);
+  parallel_for_blocks(n_threads, n, [&](uint i, size_t start, size_t end) {
+    OutT sum = 0;
+    for (size_t j = start; j < end; j++) sum += in[j];
+    block_sum[i + 1] = sum;
+  });
+  for (uint i = 0; i < n_threads; i++) block_sum[i + 1] += block_sum[i];
+  parallel_for_blocks(n_threads, n, [&](uint i, size_t start, size_t end) {
+    OutT sum = block_sum[i];
+    for (size_t j = start; j < end; j++) {
+      OutT value = in[j];
+      out[j] = sum;
+      sum += value;
+    }
+  });
+  out[n] = block_sum[n_threads];
+}
+
+#endif
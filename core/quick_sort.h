@@ -23,6 +23,11 @@
 #ifndef A_QSORT_INCLUDED
 #define A_QSORT_INCLUDED
 #include <algorithm>
+#include <memory>
+#include <vector>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 // #include "parallel.h"
 
 template <class E, class BinPred, class intT>
@@ -43,8 +48,112 @@ template <class E, class BinPred> E median(E a, E b, E c, BinPred f) {
                  : (f(a, c) ? a : (f(b, c) ? c : b));
 }
 
+// Three-way partition of A[0, n) around p, which must equal some element of
+// A. Afterwards [A, *L) are less than p, [*L, *M) are equal to it and
+// [*M, A + n) are not less than it (a few copies of p may end up there).
+template <class E, class BinPred, class intT>
+void partition3(E *A, intT n, E p, BinPred f, E **L_out, E **M_out) {
+  E *L = A;         // below L are less than pivot
+  E *M = A;         // between L and M are equal to pivot
+  E *R = A + n - 1; // above R are greater than pivot
+  while (1) {
+    while (!f(p, *M)) {
+      if (f(*M, p))
+        std::swap(*M, *(L++));
+      if (M >= R)
+        break;
+      M++;
+    }
+    while (f(p, *R))
+      R--;
+    if (M >= R)
+      break;
+    std::swap(*M, *R--);
+    if (f(*M, p))
+      std::swap(*M, *(L++));
+    M++;
+  }
+  *L_out = L;
+  *M_out = M;
+}
+
+#define QSORT_TASK_GRAIN 4096        // smaller halves are sorted inline
+#define QSORT_PAR_PARTITION 1000000  // larger inputs are partitioned in blocks
+#define QSORT_PARTITION_BLOCKS 64
+
+// Same contract as partition3, but run as one task per block: every block is
+// partitioned locally, block offsets are prefix-summed, and blocks copy their
+// three runs into a scratch array that is then copied back. Needs an
+// enclosing parallel region to actually run in parallel.
+template <class E, class BinPred, class intT>
+void parallelPartition3(E *A, intT n, E p, BinPred f, E **L_out,
+                        E **M_out) {
+  const intT blocks = QSORT_PARTITION_BLOCKS;
+  const intT block_size = (n + blocks - 1) / blocks;
+  std::vector<intT> less(blocks), equal(blocks), greater(blocks);
+  for (intT b = 0; b < blocks; b++) {
+#pragma omp task shared(less, equal, greater, f, p) firstprivate(b)
+    {
+      E *start = A + std::min(n, b * block_size);
+      E *end = A + std::min(n, (b + 1) * block_size);
+      E *mid1 = std::partition(start, end, [&](const E &x) { return f(x, p); });
+      E *mid2 = std::partition(mid1, end, [&](const E &x) { return !f(p, x); });
+      less[b] = mid1 - start;
+      equal[b] = mid2 - mid1;
+      greater[b] = end - mid2;
+    }
+  }
+#pragma omp taskwait
+
+  intT total_less = 0, total_equal = 0;
+  for (intT b = 0; b < blocks; b++) {
+    total_less += less[b];
+    total_equal += equal[b];
+  }
+  intT less_at = 0, equal_at = total_less;
+  intT greater_at = total_less + total_equal;
+  for (intT b = 0; b < blocks; b++) {
+    intT l = less[b], e = equal[b], g = greater[b];
+    less[b] = less_at;
+    equal[b] = equal_at;
+    greater[b] = greater_at;
+    less_at += l;
+    equal_at += e;
+    greater_at += g;
+  }
+
+  std::unique_ptr<E[]> tmp(new E[n]);
+  for (intT b = 0; b < blocks; b++) {
+#pragma omp task shared(less, equal, greater, tmp) firstprivate(b)
+    {
+      E *start = A + std::min(n, b * block_size);
+      E *end = A + std::min(n, (b + 1) * block_size);
+      intT l = (b + 1 < blocks ? less[b + 1] : total_less) - less[b];
+      intT e = (b + 1 < blocks ? equal[b + 1] : total_less + total_equal) -
+               equal[b];
+      std::copy(start, start + l, tmp.get() + less[b]);
+      std::copy(start + l, start + l + e, tmp.get() + equal[b]);
+      std::copy(start + l + e, end, tmp.get() + greater[b]);
+    }
+  }
+#pragma omp taskwait
+  for (intT b = 0; b < blocks; b++) {
+#pragma omp task shared(tmp) firstprivate(b)
+    {
+      intT start = std::min(n, b * block_size);
+      intT end = std::min(n, (b + 1) * block_size);
+      std::copy(tmp.get() + start, tmp.get() + end, A + start);
+    }
+  }
+#pragma omp taskwait
+  *L_out = A + total_less;
+  *M_out = A + total_less + total_equal;
+}
+
 // Quicksort based on median of three elements as pivot
-//  and uses insertionSort for small inputs
+//  and uses insertionSort for small inputs. Inside an OpenMP parallel region
+//  the halves run as tasks down to QSORT_TASK_GRAIN elements, and the top
+//  levels partition in parallel.
 template <class E, class BinPred, class intT>
 void quickSort(E *A, intT n, BinPred f) {
   if (n < ISORT)
@@ -52,31 +161,27 @@ void quickSort(E *A, intT n, BinPred f) {
   else {
     // E p = std::__median(A[n/4],A[n/2],A[(3*n)/4],f);
     E p = median(A[n / 4], A[n / 2], A[(3 * n) / 4], f);
-    E *L = A;         // below L are less than pivot
-    E *M = A;         // between L and M are equal to pivot
-    E *R = A + n - 1; // above R are greater than pivot
-    while (1) {
-      while (!f(p, *M)) {
-        if (f(*M, p))
-          std::swap(*M, *(L++));
-        if (M >= R)
-          break;
-        M++;
-      }
-      while (f(p, *R))
-        R--;
-      if (M >= R)
-        break;
-      std::swap(*M, *R--);
-      if (f(*M, p))
-        std::swap(*M, *(L++));
-      M++;
-    }
-#pragma omp task
+    E *L, *M;
+#ifdef _OPENMP
+    if (n >= QSORT_PAR_PARTITION && omp_in_parallel())
+      parallelPartition3(A, n, p, f, &L, &M);
+    else
+#endif
+      partition3(A, n, p, f, &L, &M);
+#pragma omp task if (L - A >= QSORT_TASK_GRAIN)
     quickSort(A, L - A, f);
     quickSort(M, A + n - M, f); // Exclude all elts that equal pivot
 #pragma omp taskwait
   }
 }
 
+// Sorts A[0, n) on a team of n_threads OpenMP threads. Without -fopenmp this
+// is plain sequential quickSort.
+template <class E, class BinPred, class intT>
+void parallelQuickSort(E *A, intT n, BinPred f, int n_threads) {
+#pragma omp parallel num_threads(n_threads)
+#pragma omp single
+  quickSort(A, n, f);
+}
+
 #endif // _A_QSORT_INCLUDED
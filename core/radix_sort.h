@@ -0,0 +1,151 @@
+#ifndef RADIX_SORT_H
+#define RADIX_SORT_H
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "graph.h"
+#include "parallel.h"
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+// Stable parallel LSD radix sort of A[0, n) on the 32-bit key(A[i]), one byte
+// per pass. The digits are taken from key(A[i]) - min_key, so passes for
+// bytes above the key range max_key - min_key are skipped (radix_weight_key
+// sets the top bit of every non-negative weight, so the raw keys would always
+// need all four), as are passes where every element falls into the same
+// bucket. Each pass builds one
+// histogram per thread block, prefix-sums them bucket-major so that thread t
+// writes its share of bucket d right after thread t - 1, and scatters. tmp
+// must have room for n elements; the result always ends up in A.
+template <class T, class Key>
+void radixSort(T *A, T *tmp, size_t n, uint n_threads, Key key) {
+  if (n < 2) return;
+  std::vector<uint32_t> block_min(n_threads, UINT32_MAX);
+  std::vector<uint32_t> block_max(n_threads, 0);
+  parallel_for_blocks(n_threads, n, [&](uint i, size_t start, size_t end) {
+    uint32_t min_key = UINT32_MAX;
+    uint32_t max_key = 0;
+    for (size_t j = start; j < end; j++) {
+      uint32_t k = key(A[j]);
+      min_key = std::min(min_key, k);
+      max_key = std::max(max_key, k);
+    }
+    block_min[i] = min_key;
+    block_max[i] = max_key;
+  });
+  uint32_t min_key = *std::min_element(block_min.begin(), block_min.end());
+  uint32_t key_range =
+      *std::max_element(block_max.begin(), block_max.end()) - min_key;
+  auto digit = [&](const T &x, uint shift) {
+    return ((key(x) - min_key) >> shift) & (RADIX_BUCKETS - 1);
+  };
+
+  std::vector<size_t> counts(size_t(n_threads) * RADIX_BUCKETS);
+  T *src = A;
+  T *dst = tmp;
+  for (uint shift = 0; shift < 32 && (key_range >> shift) != 0;
+       shift += RADIX_BITS) {
+    parallel_for_blocks(n_threads, n, [&](uint i, size_t start, size_t end) {
+      size_t *count = counts.data() + size_t(i) * RADIX_BUCKETS;
+      std::fill(count, count + RADIX_BUCKETS, 0);
+      for (size_t j = start; j < end; j++) {
+        count[digit(src[j], shift)]++;
+      }
+    });
+
+    size_t offset = 0;
+    bool single_bucket = false;
+    for (uint d = 0; d < RADIX_BUCKETS; d++) {
+      size_t bucket_start = offset;
+      for (uint i = 0; i < n_threads; i++) {
+        size_t count = counts[size_t(i) * RADIX_BUCKETS + d];
+        counts[size_t(i) * RADIX_BUCKETS + d] = offset;
+        offset += count;
+      }
+      if (offset - bucket_start == n) single_bucket = true;
+    }
+    if (single_bucket) continue;
+
+    parallel_for_blocks(n_threads, n, [&](uint i, size_t start, size_t end) {
+      size_t *next = counts.data() + size_t(i) * RADIX_BUCKETS;
+      for (size_t j = start; j < end; j++) {
+        dst[next[digit(src[j], shift)]++] = src[j];
+      }
+    });
+    std::swap(src, dst);
+  }
+
+  if (src != A) {
+    parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+      memcpy(A + start, src + start, (end - start) * sizeof(T));
+    });
+  }
+}
+
+// Unsigned radix key of a weight. uintE is signed, so the sign bit is
+// flipped to put negative weights before the positive ones, in the same
+// order as edge_weight_less in the other sorts.
+inline uint32_t radix_weight_key(uintE weight) {
+  return uint32_t(weight) ^ 0x80000000u;
+}
+
+// Sorts edges by weight, moving the 12-byte records on every pass.
+inline void radixSortEdges(edge_t *edges, size_t n, uint n_threads) {
+  EdgeArray tmp;
+  tmp.allocate(n);
+  radixSort(edges, tmp.data(), n, n_threads,
+            [](const edge_t &edge) { return radix_weight_key(edge.weight); });
+}
+
+// Sorts edges by weight through an array of 64-bit (weight << 32 | index)
+// keys: the passes only move 8-byte keys, and the records are gathered into
+// place once at the end. Ties keep their input order.
+inline void radixSortEdgesByKey(edge_t *edges, size_t n, uint n_threads) {
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> tmp_keys(n);
+  parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) {
+      keys[i] = (uint64_t(radix_weight_key(edges[i].weight)) << 32) | i;
+    }
+  });
+  radixSort(keys.data(), tmp_keys.data(), n, n_threads,
+            [](uint64_t k) { return uint32_t(k >> 32); });
+
+  EdgeArray sorted;
+  sorted.allocate(n);
+  parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) {
+      sorted[i] = edges[keys[i] & 0xFFFFFFFF];
+    }
+  });
+  parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+    memcpy(edges + start, sorted.data() + start,
+           (end - start) * sizeof(edge_t));
+  });
+}
+
+// Writes to order[0, n) the indices of weight[0, n) in stable ascending
+// weight order. Keys are built from the weight column alone, so that pass is
+// a dense, vectorizable read; only the 8-byte keys move while sorting.
+inline void radixSortOrderByWeight(const uintE *weight, size_t n,
+                                   uint n_threads, uint32_t *order) {
+  std::vector<uint64_t> keys(n);
+  std::vector<uint64_t> tmp_keys(n);
+  parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) {
+      keys[i] = (uint64_t(radix_weight_key(weight[i])) << 32) | i;
+    }
+  });
+  radixSort(keys.data(), tmp_keys.data(), n, n_threads,
+            [](uint64_t k) { return uint32_t(k >> 32); });
+  parallel_for_blocks(n_threads, n, [&](uint, size_t start, size_t end) {
+    for (size_t i = start; i < end; i++) order[i] = uint32_t(keys[i]);
+  });
+}
+
+#endif
@@ -0,0 +1,238 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdlib.h>
+#include <sys/types.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a deque: it pushes and pops
+// its own tasks at the back, so recently forked work stays cache-warm, and
+// idle workers steal from the front of other deques, where the oldest and
+// usually largest tasks sit. Threads outside the pool share deque 0. A thread
+// waiting on a TaskGroup runs pending tasks before it sleeps, so nested
+// fork/join never deadlocks and the caller counts as one of the n_threads.
+class ThreadPool {
+ public:
+  typedef std::function<void()> Task;
+
+ private:
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<WorkQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_;
+  std::atomic<size_t> queued_;
+  std::mutex sleep_mutex_;
+  std::condition_variable sleep_cv_;
+
+  struct WorkerIdentity {
+    const ThreadPool *pool;
+    uint index;
+  };
+  static WorkerIdentity &identity() {
+    static thread_local WorkerIdentity id = {nullptr, 0};
+    return id;
+  }
+
+  uint ownQueue() const {
+    return identity().pool == this ? identity().index : 0;
+  }
+
+  bool popTask(Task &task) {
+    uint self = ownQueue();
+    {
+      WorkQueue &queue = *queues_[self];
+      std::lock_guard<std::mutex> guard(queue.mutex);
+      if (!queue.tasks.empty()) {
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        queued_--;
+        return true;
+      }
+    }
+    for (uint k = 1; k < queues_.size(); k++) {
+      WorkQueue &victim = *queues_[(self + k) % queues_.size()];
+      std::lock_guard<std::mutex> guard(victim.mutex);
+      if (!victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        queued_--;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void workerLoop(uint index) {
+    identity().pool = this;
+    identity().index = index;
+    while (!stop_.load(std::memory_order_acquire)) {
+      if (!runPendingTask()) {
+        // submit() bumps queued_ before it takes sleep_mutex_ to notify, so
+        // a task pushed after the check above still wakes this wait.
+        std::unique_lock<std::mutex> u_lock(sleep_mutex_);
+        sleep_cv_.wait(u_lock, [&] {
+          return stop_.load() || queued_.load() > 0;
+        });
+      }
+    }
+  }
+
+ public:
+  // Starts n_threads - 1 workers; the thread that waits on a TaskGroup is
+  // the n_threads-th.
+  explicit ThreadPool(uint n_threads) : stop_(false), queued_(0) {
+    n_threads = std::max(1u, n_threads);
+    for (uint i = 0; i < n_threads; i++) {
+      queues_.emplace_back(new WorkQueue());
+    }
+    for (uint i = 1; i < n_threads; i++) {
+      threads_.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+  }
+
+  ~ThreadPool() {
+    stop_.store(true, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> guard(sleep_mutex_);
+    }
+    sleep_cv_.notify_all();
+    for (auto &thread : threads_) {
+      thread.join();
+    }
+    if (current() == this) current() = nullptr;
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  uint numThreads() const { return queues_.size(); }
+
+  void submit(Task task) {
+    WorkQueue &queue = *queues_[ownQueue()];
+    {
+      std::lock_guard<std::mutex> guard(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+      queued_++;
+    }
+    {
+      std::lock_guard<std::mutex> guard(sleep_mutex_);
+    }
+    sleep_cv_.notify_one();
+  }
+
+  // Runs one queued task, its own or a stolen one. Returns false if there
+  // was none.
+  bool runPendingTask() {
+    Task task;
+    if (!popTask(task)) return false;
+    task();
+    return true;
+  }
+
+  // Index of the calling worker in [0, numThreads()); threads outside the
+  // pool share index 0.
+  uint workerIndex() const { return ownQueue(); }
+
+  // Sleeps until a task is queued or done() holds. The thread that makes
+  // done() true must call wakeAll() afterwards.
+  template <class Pred>
+  void sleepUntil(Pred done) {
+    std::unique_lock<std::mutex> u_lock(sleep_mutex_);
+    sleep_cv_.wait(u_lock, [&] {
+      return done() || stop_.load() || queued_.load() > 0;
+    });
+  }
+
+  void wakeAll() {
+    {
+      std::lock_guard<std::mutex> guard(sleep_mutex_);
+    }
+    sleep_cv_.notify_all();
+  }
+
+  // Runs f(start, end) over disjoint subranges covering [begin, end) with
+  // lazy binary splitting: a range is halved, and its right half forked for
+  // idle workers to steal, only while no other task is queued and it is
+  // larger than grain. Busy pools therefore run few large ranges and idle
+  // ones split down to grain. grain 0 picks n / (8 * numThreads()).
+  template <class F>
+  void parallelFor(size_t begin, size_t end, F f, size_t grain = 0);
+
+  // Pool that core/parallel.h helpers run on, or null to use plain
+  // std::threads.
+  static ThreadPool *&current() {
+    static ThreadPool *pool = nullptr;
+    return pool;
+  }
+};
+
+// Fork/join scope on a ThreadPool: spawn() forks a task, wait() joins all of
+// them, running pending tasks while it waits.
+class TaskGroup {
+  ThreadPool &pool_;
+  std::atomic<size_t> pending_;
+
+ public:
+  explicit TaskGroup(ThreadPool &pool) : pool_(pool), pending_(0) {}
+  ~TaskGroup() { wait(); }
+
+  // The task only touches the pool after its decrement: once pending_ hits
+  // zero the waiter may return and destroy the group.
+  template <class F>
+  void spawn(F f) {
+    pending_++;
+    ThreadPool *pool = &pool_;
+    pool_.submit([this, pool, f]() {
+      f();
+      if (--pending_ == 0) pool->wakeAll();
+    });
+  }
+
+  // Tasks of the group that other workers are running cannot be helped
+  // with, so the waiter sleeps until one finishes the group or new work
+  // arrives.
+  void wait() {
+    while (pending_.load() > 0) {
+      if (!pool_.runPendingTask()) {
+        pool_.sleepUntil([this] { return pending_.load() == 0; });
+      }
+    }
+  }
+};
+
+template <class F>
+void ThreadPool::parallelFor(size_t begin, size_t end, F f, size_t grain) {
+  if (begin >= end) return;
+  if (numThreads() == 1) {
+    f(begin, end);
+    return;
+  }
+  if (grain == 0) {
+    grain = std::max<size_t>(1, (end - begin) / (8 * numThreads()));
+  }
+  TaskGroup group(*this);
+  while (end - begin > grain && queued_.load() == 0) {
+    size_t middle = begin + (end - begin) / 2;
+    group.spawn([this, middle, end, &f, grain]() {
+      parallelFor(middle, end, f, grain);
+    });
+    end = middle;
+  }
+  f(begin, end);
+  group.wait();
+}
+
+#endif
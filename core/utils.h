@@ -3,10 +3,13 @@
 
 #include <limits.h>
 
+#include <algorithm>
 #include <atomic>
 #include <condition_variable>
 #include <iostream>
 #include <mutex>
+#include <thread>
+#include <vector>
 
 #include "cxxopts.h"
 #include "get_time.h"
@@ -17,6 +20,7 @@
 
 #define intE int32_t
 #define uintE int32_t
+#define UINTE_MAX INT_MAX
 
 #define DEFAULT_NUMBER_OF_THREADS "1"
 #define DEFAULT_MAX_ITER "10"
@@ -54,30 +58,315 @@ struct CustomBarrier {
   }
 };
 
-class UnionFind {
+// Barrier that spins on an atomic generation counter instead of sleeping on a
+// condition variable: the last thread to arrive resets the count and bumps
+// the generation, which releases the threads waiting on the old one. Cheaper
+// than CustomBarrier for short, frequent phases; it yields while spinning so
+// oversubscribed runs still make progress.
+struct SpinBarrier {
+  int num_of_threads_;
+  std::atomic<int> current_waiting_;
+  std::atomic<int> barrier_call_;
+
+  SpinBarrier(int t_num_of_threads)
+      : num_of_threads_(t_num_of_threads),
+        current_waiting_(0),
+        barrier_call_(0) {}
+
+  void wait() {
+    int c = barrier_call_.load(std::memory_order_acquire);
+    if (current_waiting_.fetch_add(1, std::memory_order_acq_rel) + 1 ==
+        num_of_threads_) {
+      current_waiting_.store(0, std::memory_order_relaxed);
+      barrier_call_.fetch_add(1, std::memory_order_release);
+      return;
+    }
+    while (barrier_call_.load(std::memory_order_acquire) == c) {
+      std::this_thread::yield();
+    }
+  }
+};
+
+// Union-find policies. A link policy decides how roots are encoded in the
+// parent word and how two roots are joined; a compress policy decides how
+// find() shortens the path it walks. Every vertex costs one uintV either way:
+// the rank/size policies store a root's rank or size as a negative parent.
+
+// Links the root with the larger id under the smaller one (roots point to
+// themselves). This is the original UnionFind behaviour.
+struct LinkByIndex {
+  static uintV initial(uintV vertex) { return vertex; }
+  static bool isRoot(const uintV *parent, uintV vertex) {
+    return parent[vertex] == vertex;
+  }
+  static void link(uintV *parent, uintV root1, uintV root2) {
+    if (root1 < root2) {
+      parent[root2] = root1;
+    } else {
+      parent[root1] = root2;
+    }
+  }
+};
+
+// Links the smaller tree under the larger; a root stores -size.
+struct LinkBySize {
+  static uintV initial(uintV) { return -1; }
+  static bool isRoot(const uintV *parent, uintV vertex) {
+    return parent[vertex] < 0;
+  }
+  static void link(uintV *parent, uintV root1, uintV root2) {
+    if (parent[root1] > parent[root2]) std::swap(root1, root2);
+    parent[root1] += parent[root2];
+    parent[root2] = root1;
+  }
+};
+
+// Links the shallower tree under the deeper; a root stores -(rank + 1).
+struct LinkByRank {
+  static uintV initial(uintV) { return -1; }
+  static bool isRoot(const uintV *parent, uintV vertex) {
+    return parent[vertex] < 0;
+  }
+  static void link(uintV *parent, uintV root1, uintV root2) {
+    if (parent[root1] > parent[root2]) std::swap(root1, root2);
+    if (parent[root1] == parent[root2]) parent[root1]--;
+    parent[root2] = root1;
+  }
+};
+
+// Rem's algorithm: parents only ever point to larger ids, and merge() walks
+// both paths at once, splicing the lower one onto the higher as it goes, so
+// it usually stops before reaching either root. BasicUnionFind links Rem
+// roots inside that walk, so unlike the other policies it has no link().
+struct LinkRem {
+  static uintV initial(uintV vertex) { return vertex; }
+  static bool isRoot(const uintV *parent, uintV vertex) {
+    return parent[vertex] == vertex;
+  }
+};
+
+// Points every vertex on the path at the root (two passes, no recursion).
+struct FullCompression {
+  template <class Link>
+  static uintV find(uintV *parent, uintV vertex) {
+    uintV root = vertex;
+    while (!Link::isRoot(parent, root)) root = parent[root];
+    while (vertex != root) {
+      uintV next = parent[vertex];
+      parent[vertex] = root;
+      vertex = next;
+    }
+    return root;
+  }
+};
+
+// Points every other vertex on the path at its grandparent.
+struct PathHalving {
+  template <class Link>
+  static uintV find(uintV *parent, uintV vertex) {
+    while (!Link::isRoot(parent, vertex)) {
+      uintV next = parent[vertex];
+      if (Link::isRoot(parent, next)) return next;
+      parent[vertex] = parent[next];
+      vertex = parent[vertex];
+    }
+    return vertex;
+  }
+};
+
+// Points every vertex on the path at its grandparent.
+struct PathSplitting {
+  template <class Link>
+  static uintV find(uintV *parent, uintV vertex) {
+    while (!Link::isRoot(parent, vertex)) {
+      uintV next = parent[vertex];
+      if (Link::isRoot(parent, next)) return next;
+      parent[vertex] = parent[next];
+      vertex = next;
+    }
+    return vertex;
+  }
+};
+
+template <class LinkPolicy, class CompressPolicy>
+class BasicUnionFind {
   std::vector<uintV> parent;
 
+  bool mergeRoots(uintV vertex1, uintV vertex2, LinkRem) {
+    uintV *p = parent.data();
+    while (p[vertex1] != p[vertex2]) {
+      if (p[vertex1] < p[vertex2]) std::swap(vertex1, vertex2);
+      // Now p[vertex2] < p[vertex1]: hang vertex2 (or splice its path) higher.
+      if (p[vertex2] == vertex2) {
+        p[vertex2] = p[vertex1];
+        return true;
+      }
+      uintV next = p[vertex2];
+      p[vertex2] = p[vertex1];
+      vertex2 = next;
+    }
+    return false;
+  }
+
+  template <class Link>
+  bool mergeRoots(uintV vertex1, uintV vertex2, Link) {
+    vertex1 = find(vertex1);
+    vertex2 = find(vertex2);
+    if (vertex1 == vertex2) return false;
+    Link::link(parent.data(), vertex1, vertex2);
+    return true;
+  }
+
  public:
-  UnionFind(int num_of_vertices) : parent(num_of_vertices) {
+  BasicUnionFind(int num_of_vertices) : parent(num_of_vertices) {
     for (int i = 0; i < num_of_vertices; ++i) {
-      parent[i] = i;
+      parent[i] = LinkPolicy::initial(i);
+    }
+  }
+
+  uintV find(uintV vertex) {
+    return CompressPolicy::template find<LinkPolicy>(parent.data(), vertex);
+  }
+
+  size_t size() const { return parent.size(); }
+
+  // Adds singleton sets for the vertices [size(), num_of_vertices), keeping
+  // the existing sets; for vertex counts only discovered while reading.
+  void grow(int num_of_vertices) {
+    for (int i = parent.size(); i < num_of_vertices; ++i) {
+      parent.push_back(LinkPolicy::initial(i));
     }
   }
 
-  int find(uintV vertex) {
-    if (parent[vertex] != vertex) {
-      parent[vertex] = find(parent[vertex]);
+  // Makes every vertex a singleton again without reallocating.
+  void reset() {
+    for (size_t i = 0; i < parent.size(); ++i) {
+      parent[i] = LinkPolicy::initial(i);
     }
-    return parent[vertex];
   }
 
   void merge(uintV vertex1, uintV vertex2) {
-    vertex1 = find(vertex1);
-    vertex2 = find(vertex2);
-    if (vertex1 < vertex2) {
-      parent[vertex2] = vertex1;
-    } else {
-      parent[vertex1] = vertex2;
+    mergeRoots(vertex1, vertex2, LinkPolicy());
+  }
+
+  // Returns true if vertex1 and vertex2 were in different sets.
+  bool unite(uintV vertex1, uintV vertex2) {
+    return mergeRoots(vertex1, vertex2, LinkPolicy());
+  }
+};
+
+// Policies used by every engine; override at build time, e.g.
+// make UF_LINK=LinkByRank UF_COMPRESS=FullCompression
+#ifndef UNION_FIND_LINK
+#define UNION_FIND_LINK LinkBySize
+#endif
+#ifndef UNION_FIND_COMPRESS
+#define UNION_FIND_COMPRESS PathHalving
+#endif
+
+typedef BasicUnionFind<UNION_FIND_LINK, UNION_FIND_COMPRESS> UnionFind;
+
+// UnionFind over only the vertices a partition actually touches. Vertex ids
+// are mapped to dense local ids through an open-addressing hash table, so
+// memory and initialization scale with max_vertices instead of with the
+// whole graph. find() returns local ids, which are only meaningful when
+// compared with each other.
+class SparseUnionFind {
+  std::vector<uintV> keys_;
+  std::vector<uintV> local_ids_;
+  size_t mask_;
+  uintV num_local_;
+  UnionFind sets_;
+
+  static size_t tableSize(size_t max_vertices) {
+    size_t size = 16;
+    while (size < 2 * max_vertices) size <<= 1;
+    return size;
+  }
+
+  uintV localId(uintV vertex) {
+    size_t slot = (uint64_t(vertex) * 0x9E3779B97F4A7C15ULL >> 32) & mask_;
+    while (keys_[slot] != vertex) {
+      if (keys_[slot] == -1) {
+        keys_[slot] = vertex;
+        local_ids_[slot] = num_local_++;
+        break;
+      }
+      slot = (slot + 1) & mask_;
+    }
+    return local_ids_[slot];
+  }
+
+ public:
+  SparseUnionFind(size_t max_vertices)
+      : keys_(tableSize(max_vertices), -1),
+        local_ids_(tableSize(max_vertices)),
+        mask_(tableSize(max_vertices) - 1),
+        num_local_(0),
+        sets_(max_vertices) {}
+
+  uintV find(uintV vertex) { return sets_.find(localId(vertex)); }
+
+  bool unite(uintV vertex1, uintV vertex2) {
+    return sets_.unite(localId(vertex1), localId(vertex2));
+  }
+
+  // Number of distinct vertices seen so far.
+  uintV size() const { return num_local_; }
+};
+
+// Lock-free union-find for threads that share one vertex set. Parents are
+// atomic words; find() halves paths with CAS, and unite() always links the
+// root with the larger id under the one with the smaller id, so concurrent
+// unions can never form a cycle.
+class ConcurrentUnionFind {
+  std::vector<std::atomic<uintV>> parent;
+
+ public:
+  ConcurrentUnionFind(int num_of_vertices) : parent(num_of_vertices) {
+    for (int i = 0; i < num_of_vertices; ++i) {
+      parent[i].store(i, std::memory_order_relaxed);
+    }
+  }
+
+  uintV find(uintV vertex) {
+    while (true) {
+      uintV p = parent[vertex].load(std::memory_order_acquire);
+      if (p == vertex) return vertex;
+      uintV grandparent = parent[p].load(std::memory_order_acquire);
+      if (p != grandparent) {
+        parent[vertex].compare_exchange_weak(p, grandparent,
+                                             std::memory_order_release,
+                                             std::memory_order_relaxed);
+      }
+      vertex = grandparent;
+    }
+  }
+
+  // Returns true if this call joined two different sets.
+  bool unite(uintV vertex1, uintV vertex2) {
+    while (true) {
+      vertex1 = find(vertex1);
+      vertex2 = find(vertex2);
+      if (vertex1 == vertex2) return false;
+      if (vertex1 > vertex2) std::swap(vertex1, vertex2);
+      uintV expected = vertex2;
+      if (parent[vertex2].compare_exchange_strong(expected, vertex1,
+                                                  std::memory_order_acq_rel)) {
+        return true;
+      }
+    }
+  }
+
+  bool sameSet(uintV vertex1, uintV vertex2) {
+    while (true) {
+      vertex1 = find(vertex1);
+      vertex2 = find(vertex2);
+      if (vertex1 == vertex2) return true;
+      // vertex1 is still a root, so the sets really were disjoint.
+      if (parent[vertex1].load(std::memory_order_acquire) == vertex1) {
+        return false;
+      }
     }
   }
 };
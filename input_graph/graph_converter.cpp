@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "../core/graph.h"
+#include "../core/utils.h"
+
+#define DEFAULT_INPUT_FILE "graph.txt"
+#define DEFAULT_OUTPUT_FILE "graph.bin"
+
+// Converts a text edge list into the binary format read by
+// Graph::readGraphFromBinaryFile, optionally sorting the edges by weight so
+// the engines can skip their sort.
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("Graph_Converter",
+                           "Text to binary edge list converter");
+  options.add_options(
+      "custom",
+      {{"inputFile", "Text edge list to read",
+        cxxopts::value<std::string>()->default_value(DEFAULT_INPUT_FILE)},
+       {"outputFile", "Binary edge list to write",
+        cxxopts::value<std::string>()->default_value(DEFAULT_OUTPUT_FILE)},
+       {"sortByWeight", "Sort the edges by weight before writing",
+        cxxopts::value<bool>()->default_value("false")}});
+  auto cl_options = options.parse(argc, argv);
+  std::string input_file_path = cl_options["inputFile"].as<std::string>();
+  std::string output_file_path = cl_options["outputFile"].as<std::string>();
+  bool sort_by_weight = cl_options["sortByWeight"].as<bool>();
+
+  Graph g;
+  g.readGraphFromTextFile(input_file_path);
+
+  if (sort_by_weight) {
+    std::stable_sort(g.edges.begin(), g.edges.end(), edge_weight_less);
+    g.sorted_by_weight_ = true;
+  }
+
+  if (!g.writeGraphToBinaryFile(output_file_path)) {
+    std::cout << "Output File: " << output_file_path
+              << " could not be written. Terminating" << std::endl;
+    return 2;
+  }
+
+  std::cout << "Vertices: " << g.n_ << ", Edges: " << g.m_ << std::endl;
+  std::cout << "Written to " << output_file_path
+            << (sort_by_weight ? " (sorted by weight)" : "") << std::endl;
+
+  return 0;
+}
@@ -2,16 +2,58 @@
 #include <ctime>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <set>
 #include <utility>
 
+#include "../core/graph.h"
 #include "../core/utils.h"
 
 #define NUM_OF_VERTICES 1000
 #define MAX_WEIGHT 1000
 
-int main() {
-  std::ofstream output_file("graph.txt");
+// Writes edges either as "node1 node2 weight" lines to graph.txt or, with
+// --binary, straight into the binary edge-list format in graph.bin.
+class EdgeOutput {
+  bool binary_;
+  std::ofstream text_file_;
+  std::unique_ptr<BinaryGraphWriter> binary_file_;
+
+ public:
+  explicit EdgeOutput(bool binary) : binary_(binary) {
+    if (binary_) {
+      binary_file_.reset(new BinaryGraphWriter(path()));
+    } else {
+      text_file_.open(path());
+    }
+  }
+
+  const char *path() const { return binary_ ? "graph.bin" : "graph.txt"; }
+  void write(uintV node1, uintV node2, uintE edge_weight) {
+    if (binary_) {
+      binary_file_->write(edge_t(node1, node2, edge_weight));
+    } else {
+      text_file_ << node1 << " " << node2 << " " << edge_weight << '\n';
+    }
+  }
+
+  // Returns false if any write failed.
+  bool close() {
+    if (binary_) return binary_file_->finish(false, NUM_OF_VERTICES);
+    text_file_.close();
+    return !text_file_.fail();
+  }
+};
+
+int main(int argc, char *argv[]) {
+  cxxopts::Options options("Graph_Generator", "Random graph generator");
+  options.add_options(
+      "custom",
+      {{"binary", "Write graph.bin in the binary edge-list format",
+        cxxopts::value<bool>()->default_value("false")}});
+  auto cl_options = options.parse(argc, argv);
+
+  EdgeOutput output_file(cl_options["binary"].as<bool>());
   std::set<std::pair<uintV, uintV>> edge_set;
 
   srand(time(0));
@@ -21,7 +63,7 @@ int main() {
     uintV node1 = i - 1;
     uintV node2 = i;
     uintE edge_weight = 1 + (rand() % MAX_WEIGHT);
-    output_file << node1 << " " << node2 << " " << edge_weight << '\n';
+    output_file.write(node1, node2, edge_weight);
     edge_set.insert({std::min(node1, node2), std::max(node1, node2)});
   }
 
@@ -31,15 +73,18 @@ int main() {
       if (rand() % 2) {
         if (!edge_set.count({node1, node2})) {
           uintE edge_weight = 1 + (rand() % MAX_WEIGHT);
-          output_file << node1 << " " << node2 << " " << edge_weight
-                      << std::endl;
+          output_file.write(node1, node2, edge_weight);
           edge_set.insert({node1, node2});
         }
       }
     }
   }
 
-  output_file.close();
+  if (!output_file.close()) {
+    std::cout << "Output File: " << output_file.path()
+              << " could not be written. Terminating" << std::endl;
+    return 2;
+  }
 
   // For validation of the implementations
   std::cout << "Total edges generated: " << edge_set.size() << std::endl;
@@ -1,14 +1,31 @@
 #include <mpi.h>
+#include <stddef.h>
+
+#include <string.h>
 
 #include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "core/edge_codec.h"
+#include "core/edge_sort.h"
 #include "core/graph.h"
+#include "core/thread_pool.h"
 #include "core/utils.h"
 
+#define DEFAULT_NUMBER_OF_THREADS "1"
 #define DEFAULT_FILE_PATH "input_graph/graph.txt"
+#define DEFAULT_ALGORITHM "kruskal"
+#define DEFAULT_IO_MODE "collective"
+#define DEFAULT_REDUCE_MODE "tree"
+#define DEFAULT_CHUNK_EDGES "1048576"
+// Largest single MPI-IO request; counts are ints.
+#define MPI_IO_CHUNK_BYTES (1 << 30)
+// Read size used to finish a text line that runs past a rank's byte range.
+#define MPI_IO_TAIL_BYTES 4096
 
 struct MSTData {
   unsigned long edges_processed;
@@ -22,50 +39,480 @@ struct MSTData {
         time_taken(_time_taken) {}
 };
 
+// Minimum spanning forest of the union of two forests whose edges are in
+// weight order. A linear merge stands in for the sort, and the result is in
+// weight order again.
+void merge_forests(const edge_t *forest1, size_t n1, const edge_t *forest2,
+                   size_t n2, uintV num_vertices,
+                   std::vector<edge_t> &merged) {
+  std::vector<edge_t> edges(n1 + n2);
+  std::merge(forest1, forest1 + n1, forest2, forest2 + n2, edges.begin(),
+             edge_weight_less);
+  SparseUnionFind union_find(
+      std::min<size_t>(num_vertices, 2 * edges.size()));
+  merged.clear();
+  for (const auto &edge : edges) {
+    if (union_find.unite(edge.from, edge.to)) merged.push_back(edge);
+  }
+}
+
+void merge_forests(const std::vector<edge_t> &forest1,
+                   const std::vector<edge_t> &forest2, uintV num_vertices,
+                   std::vector<edge_t> &merged) {
+  merge_forests(forest1.data(), forest1.size(), forest2.data(),
+                forest2.size(), num_vertices, merged);
+}
+
+// Kruskal over edges[0, n), appending the forest to msf in weight order.
+void local_msf(const Graph &g, const edge_t *edges, size_t n,
+               SortMethod sort_method, std::vector<edge_t> &msf) {
+  std::vector<edge_t> sorted_edges(edges, edges + n);
+  if (!g.sorted_by_weight_) {
+    sortEdgesByWeight(sorted_edges.data(), sorted_edges.size(), sort_method);
+  }
+  // Sized to these edges' endpoints rather than to all g.n_ vertices.
+  SparseUnionFind union_find(std::min<size_t>(g.n_, 2 * n));
+  for (const auto &edge : sorted_edges) {
+    if (union_find.unite(edge.from, edge.to)) msf.push_back(edge);
+  }
+}
+
+// MSF of edges[0, n) on n_threads pool threads, in weight order: every
+// thread sorts and reduces one block of the edges, and the block forests are
+// then merged pairwise, the merges of each level running in parallel.
+void reduce_edges_to_forest(const Graph &g, const edge_t *edges, size_t n,
+                            SortMethod sort_method, uint n_threads,
+                            std::vector<edge_t> &forest) {
+  std::vector<std::vector<edge_t>> forests(n_threads);
+  parallel_for_blocks(n_threads, n, [&](uint i, size_t start, size_t end) {
+    local_msf(g, edges + start, end - start, sort_method, forests[i]);
+  });
+  for (uint step = 1; step < n_threads; step *= 2) {
+    parallel_tasks((n_threads + 2 * step - 1) / (2 * step), [&](uint k) {
+      uint i = 2 * step * k;
+      if (i + step >= n_threads) return;
+      std::vector<edge_t> merged;
+      merge_forests(forests[i], forests[i + step], g.n_, merged);
+      forests[i].swap(merged);
+      std::vector<edge_t>().swap(forests[i + step]);
+    });
+  }
+  forest.swap(forests[0]);
+}
+
+MSTData forest_statistics(const std::vector<edge_t> &forest,
+                          double time_taken) {
+  unsigned long weight_sum = 0;
+  for (const auto &edge : forest) weight_sum += edge.weight;
+  return MSTData{forest.size(), weight_sum, time_taken};
+}
+
+// This rank's MSF over its whole partition.
 MSTData mst_parallel_worker(Graph &g, const std::vector<edge_t> &edges_subset,
-                            std::vector<edge_t> &mst_edges_local) {
+                            std::vector<edge_t> &mst_edges_local,
+                            SortMethod sort_method, uint n_threads) {
   timer t;
   t.start();
-  unsigned long edges_processed = 0;
-  unsigned long weight_sum = 0;
-  UnionFind union_find(g.n_);
-  std::vector<edge_t> sorted_edges_subset = edges_subset;
-  std::sort(
-      sorted_edges_subset.begin(), sorted_edges_subset.end(),
-      [](const edge_t &a, const edge_t &b) { return a.weight < b.weight; });
+  reduce_edges_to_forest(g, edges_subset.data(), edges_subset.size(),
+                         sort_method, n_threads, mst_edges_local);
+  return forest_statistics(mst_edges_local, t.stop());
+}
 
-  for (const auto &edge : sorted_edges_subset) {
-    uintV root1 = union_find.find(edge.from);
-    uintV root2 = union_find.find(edge.to);
-    if (root1 != root2) {
-      edges_processed++;
-      mst_edges_local.push_back(edge);
-      union_find.merge(root1, root2);
-      weight_sum += edge.weight;
+// MPI datatype for edge_t, with its extent resized to sizeof(edge_t) so
+// arrays of edges can be sent directly. Free with MPI_Type_free.
+MPI_Datatype create_edge_datatype() {
+  int block_lengths[3] = {1, 1, 1};
+  MPI_Aint displacements[3] = {offsetof(edge_t, from), offsetof(edge_t, to),
+                               offsetof(edge_t, weight)};
+  MPI_Datatype types[3] = {MPI_INT32_T, MPI_INT32_T, MPI_INT32_T};
+  MPI_Datatype record, edge_type;
+  MPI_Type_create_struct(3, block_lengths, displacements, types, &record);
+  MPI_Type_create_resized(record, 0, sizeof(edge_t), &edge_type);
+  MPI_Type_commit(&edge_type);
+  MPI_Type_free(&record);
+  return edge_type;
+}
+
+// Splits m edges into size contiguous blocks, the first m % size of them
+// one edge larger: rank i owns [displs[i], displs[i] + counts[i]).
+void partition_edges(uint64_t m, int size, std::vector<int> &counts,
+                     std::vector<int> &displs) {
+  counts.resize(size);
+  displs.resize(size);
+  uint64_t edges_per_proc = m / size;
+  uint64_t extra_edges = m % size;
+  for (int i = 0; i < size; i++) {
+    displs[i] = i * edges_per_proc + std::min<uint64_t>(i, extra_edges);
+    counts[i] = edges_per_proc + (uint64_t(i) < extra_edges ? 1 : 0);
+  }
+}
+
+// How edge messages travel, chosen with --compress: as edge_type records, or
+// as edge_codec.h byte buffers. Tracks the bytes this rank encoded so the
+// compression ratio can be reported.
+class EdgeWire {
+  bool compress_;
+  MPI_Datatype edge_type_;
+  MPI_Comm comm_;
+
+  void encode(const edge_t *edges, size_t n, std::vector<uint8_t> &buffer) {
+    encode_edges(edges, n, buffer);
+    raw_bytes += n * sizeof(edge_t);
+    encoded_bytes += buffer.size();
+  }
+
+  void decode(const uint8_t *data, size_t bytes, std::vector<edge_t> &edges) {
+    if (!decode_edges(data, bytes, edges)) {
+      std::cout << "Received a corrupt edge message. Terminating"
+                << std::endl;
+      MPI_Abort(MPI_COMM_WORLD, 2);
     }
   }
-  double time_taken = t.stop();
 
-  return MSTData{edges_processed, weight_sum, time_taken};
+ public:
+  unsigned long long raw_bytes;
+  unsigned long long encoded_bytes;
+
+  EdgeWire(bool compress, MPI_Datatype edge_type, MPI_Comm comm)
+      : compress_(compress),
+        edge_type_(edge_type),
+        comm_(comm),
+        raw_bytes(0),
+        encoded_bytes(0) {}
+
+  bool compressed() const { return compress_; }
+  MPI_Comm comm() const { return comm_; }
+
+  void send(const edge_t *edges, size_t n, int dest) {
+    if (!compress_) {
+      MPI_Send(edges, n, edge_type_, dest, 0, comm_);
+      return;
+    }
+    std::vector<uint8_t> buffer;
+    encode(edges, n, buffer);
+    MPI_Send(buffer.data(), buffer.size(), MPI_BYTE, dest, 0, comm_);
+  }
+
+  // Receives one message from source (which may be MPI_ANY_SOURCE) into
+  // edges and returns the rank it came from.
+  int recv(int source, std::vector<edge_t> &edges) {
+    MPI_Status status;
+    int count = 0;
+    MPI_Probe(source, 0, comm_, &status);
+    if (!compress_) {
+      MPI_Get_count(&status, edge_type_, &count);
+      edges.resize(count);
+      MPI_Recv(edges.data(), count, edge_type_, status.MPI_SOURCE, 0,
+               comm_, MPI_STATUS_IGNORE);
+      return status.MPI_SOURCE;
+    }
+    MPI_Get_count(&status, MPI_BYTE, &count);
+    std::vector<uint8_t> buffer(count);
+    MPI_Recv(buffer.data(), count, MPI_BYTE, status.MPI_SOURCE, 0,
+             comm_, MPI_STATUS_IGNORE);
+    decode(buffer.data(), count, edges);
+    return status.MPI_SOURCE;
+  }
+
+  // Nonblocking send of edges[0, n); buffer holds the encoding and must
+  // outlive the request.
+  void isend(const edge_t *edges, size_t n, int dest,
+             std::vector<uint8_t> &buffer, MPI_Request *request) {
+    if (!compress_) {
+      MPI_Isend(edges, n, edge_type_, dest, 0, comm_, request);
+      return;
+    }
+    encode(edges, n, buffer);
+    MPI_Isend(buffer.data(), buffer.size(), MPI_BYTE, dest, 0, comm_,
+              request);
+  }
+
+  // Nonblocking receive of at most max_edges edges. Once the request
+  // completes, pass its status to finishRecv() to get them into edges.
+  void irecv(size_t max_edges, int source, std::vector<uint8_t> &buffer,
+             std::vector<edge_t> &edges, MPI_Request *request) {
+    if (!compress_) {
+      edges.resize(max_edges);
+      MPI_Irecv(edges.data(), max_edges, edge_type_, source, 0,
+                comm_, request);
+      return;
+    }
+    buffer.resize(edge_codec_max_bytes(max_edges));
+    MPI_Irecv(buffer.data(), buffer.size(), MPI_BYTE, source, 0,
+              comm_, request);
+  }
+
+  void finishRecv(MPI_Status &status, std::vector<uint8_t> &buffer,
+                  std::vector<edge_t> &edges) {
+    int count = 0;
+    if (!compress_) {
+      MPI_Get_count(&status, edge_type_, &count);
+      edges.resize(count);
+      return;
+    }
+    MPI_Get_count(&status, MPI_BYTE, &count);
+    decode(buffer.data(), count, edges);
+    std::vector<uint8_t>().swap(buffer);
+  }
+
+  // Rank 0 sends rank r edges[displs[r], displs[r] + counts[r]); every rank
+  // receives its block into local_edges.
+  void scatter(const edge_t *edges, const std::vector<int> &counts,
+               const std::vector<int> &displs, std::vector<edge_t> &local_edges,
+               int rank) {
+    if (!compress_) {
+      local_edges.resize(counts[rank]);
+      MPI_Scatterv(edges, counts.data(), displs.data(), edge_type_,
+                   local_edges.data(), counts[rank], edge_type_, 0,
+                   comm_);
+      return;
+    }
+    int size = counts.size();
+    std::vector<uint8_t> send;
+    std::vector<int> byte_counts(size), byte_displs(size);
+    if (rank == 0) {
+      std::vector<uint8_t> block;
+      for (int r = 0; r < size; r++) {
+        encode(edges + displs[r], counts[r], block);
+        byte_displs[r] = send.size();
+        byte_counts[r] = block.size();
+        send.insert(send.end(), block.begin(), block.end());
+      }
+    }
+    int local_bytes = 0;
+    MPI_Scatter(byte_counts.data(), 1, MPI_INT, &local_bytes, 1, MPI_INT, 0,
+                comm_);
+    std::vector<uint8_t> buffer(local_bytes);
+    MPI_Scatterv(send.data(), byte_counts.data(), byte_displs.data(),
+                 MPI_BYTE, buffer.data(), local_bytes, MPI_BYTE, 0,
+                 comm_);
+    decode(buffer.data(), local_bytes, local_edges);
+  }
+
+  // Collects every rank's edges on rank 0, concatenated in rank order.
+  void gather(const std::vector<edge_t> &edges, std::vector<edge_t> &final,
+              int rank, int size) {
+    std::vector<uint8_t> buffer;
+    const void *send = edges.data();
+    int local_count = edges.size();
+    MPI_Datatype type = edge_type_;
+    if (compress_) {
+      encode(edges.data(), edges.size(), buffer);
+      send = buffer.data();
+      local_count = buffer.size();
+      type = MPI_BYTE;
+    }
+    std::vector<int> counts(size), displs(size);
+    MPI_Gather(&local_count, 1, MPI_INT, counts.data(), 1, MPI_INT, 0,
+               comm_);
+    for (int i = 1; i < size; i++) displs[i] = displs[i - 1] + counts[i - 1];
+    size_t total = displs[size - 1] + counts[size - 1];
+    if (!compress_) {
+      if (rank == 0) final.resize(total);
+      MPI_Gatherv(send, local_count, type, final.data(), counts.data(),
+                  displs.data(), type, 0, comm_);
+      return;
+    }
+    std::vector<uint8_t> received(rank == 0 ? total : 0);
+    MPI_Gatherv(send, local_count, type, received.data(), counts.data(),
+                displs.data(), type, 0, comm_);
+    if (rank != 0) return;
+    final.clear();
+    std::vector<edge_t> block;
+    for (int i = 0; i < size; i++) {
+      decode(received.data() + displs[i], counts[i], block);
+      final.insert(final.end(), block.begin(), block.end());
+    }
+  }
+};
+
+// Collectively reads bytes [offset, offset + bytes) into buffer, in as many
+// rounds of at most MPI_IO_CHUNK_BYTES as the largest rank needs. Every rank
+// of comm, the communicator file was opened on, must call it, each with its
+// own range, which may be empty. Returns false if a read failed on this rank.
+bool read_at_all(MPI_File file, MPI_Offset offset, char *buffer,
+                 size_t bytes, MPI_Comm comm) {
+  unsigned long long rounds =
+      (bytes + MPI_IO_CHUNK_BYTES - 1) / MPI_IO_CHUNK_BYTES;
+  unsigned long long max_rounds = 0;
+  MPI_Allreduce(&rounds, &max_rounds, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX,
+                comm);
+  bool ok = true;
+  for (unsigned long long r = 0; r < max_rounds; r++) {
+    size_t done = std::min<size_t>(r * MPI_IO_CHUNK_BYTES, bytes);
+    int count = std::min<size_t>(MPI_IO_CHUNK_BYTES, bytes - done);
+    MPI_Status status;
+    int received = 0;
+    if (MPI_File_read_at_all(file, offset + done, buffer + done, count,
+                             MPI_BYTE, &status) != MPI_SUCCESS) {
+      ok = false;
+      continue;
+    }
+    MPI_Get_count(&status, MPI_BYTE, &received);
+    if (received != count) ok = false;
+  }
+  return ok;
 }
 
-void distribute_edges(const Graph &g, std::vector<edge_t> &local_edges,
-                      int rank, int size) {
-  int total_edges = g.edges.size();
-  int edges_per_proc = total_edges / size;
-  int extra_edges = total_edges % size;
-  int start_index = rank * edges_per_proc + std::min(rank, extra_edges);
-  int end_index = start_index + edges_per_proc + (rank < extra_edges ? 1 : 0);
+// Reads this rank's block of the m edges of a binary edge list. Returns false
+// if the read failed on this rank.
+bool read_local_binary_edges(MPI_File file, const BinaryGraphHeader &header,
+                             std::vector<edge_t> &local_edges, int rank,
+                             int size, MPI_Comm comm) {
+  std::vector<int> counts, displs;
+  partition_edges(header.m, size, counts, displs);
+  local_edges.resize(counts[rank]);
+  return read_at_all(
+      file, header.header_bytes + uint64_t(displs[rank]) * sizeof(edge_t),
+      reinterpret_cast<char *>(local_edges.data()),
+      uint64_t(counts[rank]) * sizeof(edge_t), comm);
+}
+
+// Reads and parses the lines of a text edge list that start inside this
+// rank's 1/size share of the bytes. Each rank also reads the byte before its
+// share, to tell whether its first line starts there or belongs to the rank
+// before, and reads past its share to finish its last line. A rank whose
+// share is empty, as with fewer bytes than ranks, still joins the collective
+// reads with an empty range. Lines with out-of-range values are counted in
+// rejected. Returns false if a read failed on this rank.
+bool read_local_text_edges(MPI_File file, MPI_Offset file_size,
+                           std::vector<edge_t> &local_edges,
+                           size_t &rejected, int rank, int size,
+                           MPI_Comm comm) {
+  MPI_Offset start = file_size / size * rank;
+  MPI_Offset end =
+      (rank == size - 1) ? file_size : file_size / size * (rank + 1);
+  MPI_Offset read_start = std::max<MPI_Offset>(0, start - 1);
+  std::vector<char> text(start == end ? 0 : end - read_start);
+  bool ok = read_at_all(file, read_start, text.data(), text.size(), comm);
+  local_edges.clear();
+  if (!ok || text.empty()) return ok;
 
-  local_edges.insert(local_edges.end(), g.edges.begin() + start_index,
-                     g.edges.begin() + end_index);
+  MPI_Offset pos = end;
+  while (pos < file_size && text.back() != '\n') {
+    char tail[MPI_IO_TAIL_BYTES];
+    MPI_Status status;
+    int count = 0;
+    if (MPI_File_read_at(
+            file, pos, tail,
+            std::min<MPI_Offset>(MPI_IO_TAIL_BYTES, file_size - pos),
+            MPI_BYTE, &status) != MPI_SUCCESS) {
+      return false;
+    }
+    MPI_Get_count(&status, MPI_BYTE, &count);
+    if (count <= 0) break;
+    const char *newline = static_cast<const char *>(memchr(tail, '\n', count));
+    int used = (newline == nullptr) ? count : newline - tail + 1;
+    text.insert(text.end(), tail, tail + used);
+    pos += used;
+  }
+
+  const char *begin = text.data();
+  const char *stop = text.data() + text.size();
+  if (start > 0) {
+    const char *newline =
+        static_cast<const char *>(memchr(begin, '\n', stop - begin));
+    begin = (newline == nullptr) ? stop : newline + 1;
+  }
+  uintV max_vertex_id = 0;
+  local_edges.resize(count_lines(begin, stop));
+  local_edges.resize(parse_edge_lines(begin, stop, local_edges.data(),
+                                      max_vertex_id, rejected));
+  return true;
+}
+
+// Loads this rank's share of the edges with MPI-IO collective reads over
+// comm, so no rank ever holds the whole graph, and settles n and m with
+// reductions. Returns false, on every rank of comm, if the file cannot be
+// read.
+bool read_graph_collective(const std::string &input_file_path, Graph &g,
+                           std::vector<edge_t> &local_edges, int rank,
+                           int size, MPI_Comm comm) {
+  MPI_File file;
+  if (MPI_File_open(comm, input_file_path.c_str(), MPI_MODE_RDONLY,
+                    MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    if (rank == 0) {
+      std::cout << "Input File: " << input_file_path
+                << " does not exist. Terminating" << std::endl;
+    }
+    return false;
+  }
+  MPI_Offset file_size = 0;
+  MPI_File_get_size(file, &file_size);
+
+  BinaryGraphHeader header;
+  size_t header_bytes = std::min<MPI_Offset>(sizeof(header), file_size);
+  int read_ok =
+      read_at_all(file, 0, reinterpret_cast<char *>(&header), header_bytes,
+                  comm);
+
+  uint64_t n = 0;
+  size_t rejected = 0;
+  // Cleared if a binary payload has an edge id outside [0, header.n).
+  int ids_ok = 1;
+  g.sorted_by_weight_ = false;
+  if (header_bytes == sizeof(header) && header.hasMagic()) {
+    if (!header.isSupported(file_size) || header.m > uint64_t(UINTE_MAX)) {
+      if (rank == 0) {
+        std::cout << "Input File: " << input_file_path
+                  << " has an unsupported binary header. Terminating"
+                  << std::endl;
+      }
+      MPI_File_close(&file);
+      return false;
+    }
+    read_ok &=
+        read_local_binary_edges(file, header, local_edges, rank, size, comm);
+    ids_ok = edge_ids_below(local_edges.data(), local_edges.size(), header.n);
+    n = header.n;
+    g.sorted_by_weight_ = header.flags & BINARY_GRAPH_SORTED_BY_WEIGHT;
+  } else {
+    read_ok &= read_local_text_edges(file, file_size, local_edges, rejected,
+                                     rank, size, comm);
+  }
+  MPI_File_close(&file);
+  int local_ok[2] = {read_ok, ids_ok};
+  int all_ok[2] = {0, 0};
+  MPI_Allreduce(local_ok, all_ok, 2, MPI_INT, MPI_MIN, comm);
+  if (!all_ok[0]) {
+    if (rank == 0) {
+      std::cout << "Input File: " << input_file_path
+                << " could not be read. Terminating" << std::endl;
+    }
+    return false;
+  }
+  if (!all_ok[1]) {
+    if (rank == 0) {
+      std::cout << "Input File: " << input_file_path
+                << " has an unsupported binary header. Terminating"
+                << std::endl;
+    }
+    return false;
+  }
+
+  uint64_t local_n = 0;
+  for (const auto &edge : local_edges) {
+    local_n = std::max(local_n, uint64_t(std::max(edge.from, edge.to)) + 1);
+  }
+  local_n = std::max(local_n, n);
+  unsigned long long local_m = local_edges.size();
+  unsigned long long local_rejected = rejected;
+  unsigned long long global_n = 0, global_m = 0, global_rejected = 0;
+  MPI_Allreduce(&local_n, &global_n, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX,
+                comm);
+  MPI_Allreduce(&local_m, &global_m, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+                comm);
+  MPI_Reduce(&local_rejected, &global_rejected, 1, MPI_UNSIGNED_LONG_LONG,
+             MPI_SUM, 0, comm);
+  if (rank == 0) report_rejected_lines(input_file_path, global_rejected);
+  g.n_ = global_n;
+  g.m_ = global_m;
+  return true;
 }
 
 uintE calculate_local_mst_weight(std::vector<edge_t> &edges, uintV num_vertices,
-                                 uint &count) {
-  std::sort(edges.begin(), edges.end(), [](const edge_t &a, const edge_t &b) {
-    return a.weight < b.weight;
-  });
+                                 uint &count, SortMethod sort_method) {
+  sortEdgesByWeight(edges.data(), edges.size(), sort_method);
   UnionFind union_find(num_vertices);
   uintE weight_sum = 0;
   for (const auto &edge : edges) {
@@ -80,9 +527,497 @@ uintE calculate_local_mst_weight(std::vector<edge_t> &edges, uintV num_vertices,
   return weight_sum;
 }
 
+// --io root --pipeline: rank 0 posts every rank's block as nonblocking sends
+// of at most chunk_edges edges, straight out of g.edges, and reduces its own
+// block while they drain. The other ranks post receives for all of their
+// chunks and reduce each chunk as soon as MPI_Waitany reports it, folding its
+// forest into the running one, so sorting overlaps with the transfer of the
+// chunks still in flight.
+MSTData pipelined_local_msf(Graph &g, std::vector<edge_t> &mst_edges_local,
+                            SortMethod sort_method, uint n_threads,
+                            size_t chunk_edges, int rank, int size,
+                            EdgeWire &wire) {
+  timer t;
+  t.start();
+  std::vector<int> counts, displs;
+  partition_edges(g.m_, size, counts, displs);
+  if (rank == 0) {
+    size_t num_chunks = 0;
+    for (int r = 1; r < size; r++) {
+      num_chunks += (counts[r] + chunk_edges - 1) / chunk_edges;
+    }
+    std::vector<MPI_Request> requests(num_chunks);
+    std::vector<std::vector<uint8_t>> buffers(num_chunks);
+    size_t k = 0;
+    for (int r = 1; r < size; r++) {
+      for (size_t offset = 0; offset < size_t(counts[r]);
+           offset += chunk_edges, k++) {
+        wire.isend(g.edges.data() + displs[r] + offset,
+                   std::min<size_t>(chunk_edges, counts[r] - offset), r,
+                   buffers[k], &requests[k]);
+      }
+    }
+    reduce_edges_to_forest(g, g.edges.data(), counts[0], sort_method,
+                           n_threads, mst_edges_local);
+    MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+    return forest_statistics(mst_edges_local, t.stop());
+  }
+
+  size_t n = counts[rank];
+  int num_chunks = (n + chunk_edges - 1) / chunk_edges;
+  std::vector<MPI_Request> requests(num_chunks);
+  std::vector<std::vector<uint8_t>> buffers(num_chunks);
+  std::vector<std::vector<edge_t>> chunks(num_chunks);
+  for (int k = 0; k < num_chunks; k++) {
+    size_t offset = k * chunk_edges;
+    wire.irecv(std::min(chunk_edges, n - offset), 0, buffers[k], chunks[k],
+               &requests[k]);
+  }
+  for (int received = 0; received < num_chunks; received++) {
+    int k;
+    MPI_Status status;
+    MPI_Waitany(num_chunks, requests.data(), &k, &status);
+    wire.finishRecv(status, buffers[k], chunks[k]);
+    std::vector<edge_t> chunk_forest, merged;
+    reduce_edges_to_forest(g, chunks[k].data(), chunks[k].size(), sort_method,
+                           n_threads, chunk_forest);
+    std::vector<edge_t>().swap(chunks[k]);
+    merge_forests(mst_edges_local, chunk_forest, g.n_, merged);
+    mst_edges_local.swap(merged);
+  }
+  return forest_statistics(mst_edges_local, t.stop());
+}
+
+// --reduce stream and --reduce gather --pipeline: rank 0 takes the forests
+// in whatever order they arrive, probing with MPI_ANY_SOURCE, and merges
+// each into its running MSF with a linear merge plus union-find. Nothing is
+// exchanged up front, so merging starts as soon as the first rank is done, a
+// slow rank never holds up forests that are already there, and nothing is
+// sorted again at the end. Leaves the MSF in forest on rank 0.
+void stream_forests_to_root(std::vector<edge_t> &forest, uintV num_vertices,
+                            int rank, int size, EdgeWire &wire) {
+  if (rank != 0) {
+    wire.send(forest.data(), forest.size(), 0);
+    forest.clear();
+    return;
+  }
+  std::vector<edge_t> received, merged;
+  for (int done = 1; done < size; done++) {
+    wire.recv(MPI_ANY_SOURCE, received);
+    merge_forests(forest, received, num_vertices, merged);
+    forest.swap(merged);
+  }
+}
+
+// Binomial-tree reduction of the ranks' weight-ordered forests. In the round
+// with step s, rank r with r % 2s == s sends its forest to rank r - s and
+// drops out, and the receiver merges it into its own. After ceil(log2 size)
+// rounds rank 0 holds the MSF, having merged at most n - 1 edges per round.
+void reduce_forests_tree(std::vector<edge_t> &forest, uintV num_vertices,
+                         int rank, int size, EdgeWire &wire) {
+  for (int step = 1; step < size; step *= 2) {
+    if (rank % (2 * step) == step) {
+      wire.send(forest.data(), forest.size(), rank - step);
+      forest.clear();
+      return;
+    }
+    if (rank + step < size) {
+      std::vector<edge_t> received, merged;
+      wire.recv(rank + step, received);
+      merge_forests(forest, received, num_vertices, merged);
+      forest.swap(merged);
+    }
+  }
+}
+
+// --shm: the ranks sharing a node (MPI_COMM_TYPE_SHARED) and, on each
+// node's leader (node rank 0), a communicator linking the leaders of all
+// nodes. World rank 0 is always leader 0. Call free() before MPI_Finalize.
+struct NodeGroup {
+  MPI_Comm node_comm;
+  MPI_Comm leader_comm;
+  int node_rank, node_size;
+  int leader_rank, leader_size;
+
+  explicit NodeGroup(int rank) : leader_rank(0), leader_size(0) {
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank,
+                        MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    MPI_Comm_size(node_comm, &node_size);
+    MPI_Comm_split(MPI_COMM_WORLD, isLeader() ? 0 : MPI_UNDEFINED, rank,
+                   &leader_comm);
+    if (isLeader()) {
+      MPI_Comm_rank(leader_comm, &leader_rank);
+      MPI_Comm_size(leader_comm, &leader_size);
+    }
+  }
+
+  bool isLeader() const { return node_rank == 0; }
+
+  void free() {
+    if (leader_comm != MPI_COMM_NULL) MPI_Comm_free(&leader_comm);
+    MPI_Comm_free(&node_comm);
+  }
+};
+
+// --shm loading: the node leaders read the graph collectively among
+// themselves and each copies its share into one window allocated in the
+// node's shared memory, so a node holds its edges once however many ranks
+// it runs. On return every rank of the node sees the same edges[0, n);
+// window owns them until MPI_Win_free. Returns false, on every rank, if the
+// file cannot be read.
+bool load_node_edges(const std::string &input_file_path, Graph &g,
+                     const NodeGroup &node, MPI_Win &window,
+                     const edge_t *&edges, size_t &n) {
+  std::vector<edge_t> loaded;
+  int ok = 1;
+  if (node.isLeader()) {
+    ok = read_graph_collective(input_file_path, g, loaded, node.leader_rank,
+                               node.leader_size, node.leader_comm);
+  }
+  MPI_Bcast(&ok, 1, MPI_INT, 0, node.node_comm);
+  if (!ok) return false;
+  MPI_Bcast(&g.n_, 1, MPI_UINT32_T, 0, node.node_comm);
+  MPI_Bcast(&g.m_, 1, MPI_UINT32_T, 0, node.node_comm);
+  MPI_Bcast(&g.sorted_by_weight_, 1, MPI_CXX_BOOL, 0, node.node_comm);
+
+  edge_t *own;
+  MPI_Win_allocate_shared(loaded.size() * sizeof(edge_t), sizeof(edge_t),
+                          MPI_INFO_NULL, node.node_comm, &own, &window);
+  std::copy(loaded.begin(), loaded.end(), own);
+  std::vector<edge_t>().swap(loaded);
+  MPI_Win_fence(0, window);
+
+  MPI_Aint bytes;
+  int disp_unit;
+  edge_t *base;
+  MPI_Win_shared_query(window, 0, &bytes, &disp_unit, &base);
+  edges = base;
+  n = bytes / sizeof(edge_t);
+  return true;
+}
+
+// --shm: every rank of a node publishes its forest in a shared window and
+// the leader merges them straight out of its peers' segments, so forests
+// never leave the node as messages. Leaves the node's MSF in forest on the
+// leader.
+void merge_node_forests(std::vector<edge_t> &forest, uintV num_vertices,
+                        const NodeGroup &node) {
+  size_t bytes = node.isLeader() ? 0 : forest.size() * sizeof(edge_t);
+  edge_t *own;
+  MPI_Win window;
+  MPI_Win_allocate_shared(bytes, sizeof(edge_t), MPI_INFO_NULL,
+                          node.node_comm, &own, &window);
+  if (!node.isLeader()) std::copy(forest.begin(), forest.end(), own);
+  MPI_Win_fence(0, window);
+  if (node.isLeader()) {
+    for (int i = 1; i < node.node_size; i++) {
+      MPI_Aint segment_bytes;
+      int disp_unit;
+      edge_t *segment;
+      MPI_Win_shared_query(window, i, &segment_bytes, &disp_unit, &segment);
+      std::vector<edge_t> merged;
+      merge_forests(forest.data(), forest.size(), segment,
+                    segment_bytes / sizeof(edge_t), num_vertices, merged);
+      forest.swap(merged);
+    }
+  } else {
+    forest.clear();
+  }
+  // Peers keep their segments mapped until the leader is done with them.
+  MPI_Win_fence(0, window);
+  MPI_Win_free(&window);
+}
+
+// Block partition of the vertex ids [0, n) over the ranks: rank r owns
+// [r * block, (r + 1) * block).
+struct VertexPartition {
+  uintV block;
+  int rank;
+
+  VertexPartition(uintV n, int rank_, int size)
+      : block(std::max<uintV>(1, (uint64_t(n) + size - 1) / size)),
+        rank(rank_) {}
+
+  int owner(uintV v) const { return v / block; }
+  uintV first() const { return uint64_t(rank) * block; }
+  bool owns(uintV v) const { return owner(v) == rank; }
+};
+
+// Send and receive layout of one MPI_Alltoallv whose send buffer is grouped
+// by destination rank. build() takes the per-destination send counts and
+// exchanges them to learn the receive counts.
+struct ExchangePlan {
+  std::vector<int> send_counts, send_displs, recv_counts, recv_displs;
+  size_t total_send, total_recv;
+
+  void build(const std::vector<int> &counts) {
+    int size = counts.size();
+    send_counts = counts;
+    recv_counts.assign(size, 0);
+    MPI_Alltoall(send_counts.data(), 1, MPI_INT, recv_counts.data(), 1,
+                 MPI_INT, MPI_COMM_WORLD);
+    send_displs.assign(size, 0);
+    recv_displs.assign(size, 0);
+    for (int i = 1; i < size; i++) {
+      send_displs[i] = send_displs[i - 1] + send_counts[i - 1];
+      recv_displs[i] = recv_displs[i - 1] + recv_counts[i - 1];
+    }
+    total_send = send_displs[size - 1] + send_counts[size - 1];
+    total_recv = recv_displs[size - 1] + recv_counts[size - 1];
+  }
+};
+
+// Sends items[i] to rank dest(items[i]) and fills received with the items
+// sent to this rank, grouped by source rank. Collective.
+template <class T, class Dest>
+void route_to_ranks(const std::vector<T> &items, Dest dest, int size,
+                    MPI_Datatype type, std::vector<T> &received) {
+  std::vector<int> counts(size, 0);
+  for (const auto &item : items) counts[dest(item)]++;
+  ExchangePlan plan;
+  plan.build(counts);
+  std::vector<T> send(plan.total_send);
+  std::vector<int> cursor = plan.send_displs;
+  for (const auto &item : items) send[cursor[dest(item)]++] = item;
+  received.resize(plan.total_recv);
+  MPI_Alltoallv(send.data(), plan.send_counts.data(),
+                plan.send_displs.data(), type, received.data(),
+                plan.recv_counts.data(), plan.recv_displs.data(), type,
+                MPI_COMM_WORLD);
+}
+
+// Sends every vertex id in keys to the rank that owns it, which replaces it
+// with answer(key), and writes the replies to answers in the order of keys.
+// Collective.
+template <class Answer>
+void query_owners(const std::vector<uintV> &keys,
+                  const VertexPartition &partition, int size, Answer answer,
+                  std::vector<uintV> &answers) {
+  std::vector<int> counts(size, 0);
+  for (uintV key : keys) counts[partition.owner(key)]++;
+  ExchangePlan plan;
+  plan.build(counts);
+  std::vector<uintV> send(plan.total_send);
+  std::vector<size_t> slot(keys.size());
+  std::vector<int> cursor = plan.send_displs;
+  for (size_t i = 0; i < keys.size(); i++) {
+    slot[i] = cursor[partition.owner(keys[i])]++;
+    send[slot[i]] = keys[i];
+  }
+  std::vector<uintV> requests(plan.total_recv);
+  MPI_Alltoallv(send.data(), plan.send_counts.data(),
+                plan.send_displs.data(), MPI_INT32_T, requests.data(),
+                plan.recv_counts.data(), plan.recv_displs.data(), MPI_INT32_T,
+                MPI_COMM_WORLD);
+  for (auto &request : requests) request = answer(request);
+  MPI_Alltoallv(requests.data(), plan.recv_counts.data(),
+                plan.recv_displs.data(), MPI_INT32_T, send.data(),
+                plan.send_counts.data(), plan.send_displs.data(), MPI_INT32_T,
+                MPI_COMM_WORLD);
+  answers.resize(keys.size());
+  for (size_t i = 0; i < keys.size(); i++) answers[i] = send[slot[i]];
+}
+
+// Strict total order on edges: by weight, then by endpoints. Every rank
+// breaks ties the same way, which Boruvka needs to avoid hooking cycles.
+inline bool boruvka_edge_less(const edge_t &a, const edge_t &b) {
+  if (a.weight != b.weight) return a.weight < b.weight;
+  uintV a_low = std::min(a.from, a.to), b_low = std::min(b.from, b.to);
+  if (a_low != b_low) return a_low < b_low;
+  return std::max(a.from, a.to) < std::max(b.from, b.to);
+}
+
+// Lightest edge found so far from component comp to component other.
+struct BoruvkaCandidate {
+  uintV comp;
+  uintV other;
+  edge_t edge;
+};
+
+// Distributed Boruvka over a block partition of the vertices. Every rank
+// keeps the edges incident to its vertices (cut edges live on both sides),
+// the component ids of its vertices, and ghost copies of the component ids
+// of its edges' remote endpoints. Component ids are vertex ids, so the
+// component root c is stored by owner(c). Each round:
+//   1. every rank proposes its lightest outgoing edge per component, and
+//      the root's owner keeps the lightest proposal;
+//   2. each root hooks onto the component its edge leads to; of a mutual
+//      pair, the smaller id stays a root and the shared edge is kept once;
+//   3. pointer jumping flattens the hooked trees onto their roots;
+//   4. vertices and ghosts are relabeled with their new roots.
+// No rank ever holds more than its own vertices, edges and ghosts. Returns
+// this rank's statistics and fills mst_edges_local with the MSF edges it
+// added.
+MSTData mst_boruvka_distributed(const Graph &g,
+                                const std::vector<edge_t> &loaded_edges,
+                                std::vector<edge_t> &mst_edges_local, int rank,
+                                int size, MPI_Datatype edge_type) {
+  timer t;
+  t.start();
+  VertexPartition partition(g.n_, rank, size);
+
+  // Route every edge to the owners of its endpoints, oriented so that
+  // from is owned by the receiver; an edge inside one rank is kept once.
+  std::vector<edge_t> outgoing;
+  outgoing.reserve(2 * loaded_edges.size());
+  for (const auto &edge : loaded_edges) {
+    if (edge.from == edge.to) continue;
+    outgoing.push_back(edge);
+    if (partition.owner(edge.from) != partition.owner(edge.to)) {
+      outgoing.push_back(edge_t(edge.to, edge.from, edge.weight));
+    }
+  }
+  std::vector<edge_t> edges;
+  route_to_ranks(
+      outgoing, [&](const edge_t &edge) { return partition.owner(edge.from); },
+      size, edge_type, edges);
+  std::vector<edge_t>().swap(outgoing);
+
+  uintV first = partition.first();
+  uintV owned = std::max<int64_t>(
+      0, std::min<int64_t>(partition.block, int64_t(g.n_) - first));
+  std::vector<uintV> comp(owned), parent(owned);
+  for (uintV i = 0; i < owned; i++) comp[i] = parent[i] = first + i;
+
+  // Remote endpoints, sorted, with their component ids alongside.
+  std::vector<uintV> ghosts;
+  for (const auto &edge : edges) {
+    if (!partition.owns(edge.to)) ghosts.push_back(edge.to);
+  }
+  std::sort(ghosts.begin(), ghosts.end());
+  ghosts.erase(std::unique(ghosts.begin(), ghosts.end()), ghosts.end());
+  std::vector<uintV> ghost_comp = ghosts;
+  // to_slot[i] locates edges[i].to: below owned it is an owned vertex,
+  // otherwise a ghost, so rounds never search for endpoints.
+  std::vector<uint32_t> to_slot(edges.size());
+  for (size_t i = 0; i < edges.size(); i++) {
+    uintV to = edges[i].to;
+    to_slot[i] = partition.owns(to)
+                     ? to - first
+                     : owned + (std::lower_bound(ghosts.begin(), ghosts.end(),
+                                                 to) -
+                                ghosts.begin());
+  }
+  auto comp_of_slot = [&](uint32_t slot) {
+    return slot < owned ? comp[slot] : ghost_comp[slot - owned];
+  };
+
+  MPI_Datatype candidate_type;
+  MPI_Type_contiguous(sizeof(BoruvkaCandidate), MPI_BYTE, &candidate_type);
+  MPI_Type_commit(&candidate_type);
+
+  unsigned long weight_sum = 0;
+  while (true) {
+    // 1. Lightest outgoing edge per component, first per rank, then per
+    // component at the root's owner. Edges inside a component are dropped.
+    std::unordered_map<uintV, BoruvkaCandidate> local_best;
+    auto propose = [&](uintV c, uintV other, const edge_t &edge) {
+      auto it = local_best.find(c);
+      if (it == local_best.end()) {
+        local_best[c] = BoruvkaCandidate{c, other, edge};
+      } else if (boruvka_edge_less(edge, it->second.edge)) {
+        it->second.other = other;
+        it->second.edge = edge;
+      }
+    };
+    size_t kept = 0;
+    for (size_t i = 0; i < edges.size(); i++) {
+      const edge_t edge = edges[i];
+      uint32_t slot = to_slot[i];
+      uintV c_from = comp[edge.from - first];
+      uintV c_to = comp_of_slot(slot);
+      if (c_from == c_to) continue;
+      edges[kept] = edge;
+      to_slot[kept++] = slot;
+      propose(c_from, c_to, edge);
+      if (slot < owned) propose(c_to, c_from, edge);
+    }
+    edges.resize(kept);
+    to_slot.resize(kept);
+
+    std::vector<BoruvkaCandidate> proposals;
+    proposals.reserve(local_best.size());
+    for (const auto &entry : local_best) proposals.push_back(entry.second);
+    std::vector<BoruvkaCandidate> received;
+    route_to_ranks(
+        proposals,
+        [&](const BoruvkaCandidate &c) { return partition.owner(c.comp); },
+        size, candidate_type, received);
+    std::unordered_map<uintV, BoruvkaCandidate> best;
+    for (const auto &candidate : received) {
+      auto it = best.find(candidate.comp);
+      if (it == best.end() ||
+          boruvka_edge_less(candidate.edge, it->second.edge)) {
+        best[candidate.comp] = candidate;
+      }
+    }
+
+    unsigned long long local_active = best.size(), active = 0;
+    MPI_Allreduce(&local_active, &active, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM,
+                  MPI_COMM_WORLD);
+    if (active == 0) break;
+
+    // 2. Hook every root with an edge onto the component it leads to.
+    std::vector<uintV> hooked, targets;
+    for (const auto &entry : best) {
+      parent[entry.first - first] = entry.second.other;
+      hooked.push_back(entry.first);
+      targets.push_back(entry.second.other);
+    }
+    std::vector<uintV> target_parents;
+    query_owners(targets, partition, size,
+                 [&](uintV c) { return parent[c - first]; }, target_parents);
+    for (size_t i = 0; i < hooked.size(); i++) {
+      uintV c = hooked[i];
+      if (target_parents[i] == c && c < targets[i]) {
+        parent[c - first] = c;
+      } else {
+        const edge_t &edge = best[c].edge;
+        mst_edges_local.push_back(edge);
+        weight_sum += edge.weight;
+      }
+    }
+
+    // 3. Pointer jumping until every hooked root points at a root.
+    while (true) {
+      std::vector<uintV> parents(hooked.size());
+      for (size_t i = 0; i < hooked.size(); i++) {
+        parents[i] = parent[hooked[i] - first];
+      }
+      std::vector<uintV> grandparents;
+      query_owners(parents, partition, size,
+                   [&](uintV c) { return parent[c - first]; }, grandparents);
+      int local_changed = 0, changed = 0;
+      for (size_t i = 0; i < hooked.size(); i++) {
+        if (grandparents[i] != parents[i]) {
+          parent[hooked[i] - first] = grandparents[i];
+          local_changed = 1;
+        }
+      }
+      MPI_Allreduce(&local_changed, &changed, 1, MPI_INT, MPI_MAX,
+                    MPI_COMM_WORLD);
+      if (!changed) break;
+    }
+
+    // 4. Relabel owned vertices through their old root, then refresh the
+    // ghosts from their owners.
+    query_owners(comp, partition, size,
+                 [&](uintV c) { return parent[c - first]; }, comp);
+    query_owners(ghosts, partition, size,
+                 [&](uintV v) { return comp[v - first]; }, ghost_comp);
+  }
+
+  MPI_Type_free(&candidate_type);
+  double time_taken = t.stop();
+  return MSTData{mst_edges_local.size(), weight_sum, time_taken};
+}
+
 int main(int argc, char *argv[]) {
   int rank, size;
-  MPI_Init(&argc, &argv);
+  // Only the main thread calls MPI; pool threads just sort and merge.
+  int thread_support;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
 
   MPI_Comm_rank(MPI_COMM_WORLD, &rank);
   MPI_Comm_size(MPI_COMM_WORLD, &size);
@@ -90,66 +1025,209 @@ int main(int argc, char *argv[]) {
   cxxopts::Options options("MST_MPI", "Minimum Spanning Tree Algorithm");
   options.add_options(
       "custom",
-      {{"inputFile", "Input file path",
-        cxxopts::value<std::string>()->default_value(DEFAULT_FILE_PATH)}});
+      {{"inputFile", "Input file path (text or binary edge list)",
+        cxxopts::value<std::string>()->default_value(DEFAULT_FILE_PATH)},
+       {"nThreads", "Number of threads per rank",
+        cxxopts::value<uint>()->default_value(DEFAULT_NUMBER_OF_THREADS)},
+       {"algo",
+        "MST algorithm: kruskal (edge partitions plus a forest reduction) or "
+        "boruvka (vertex partitions)",
+        cxxopts::value<std::string>()->default_value(DEFAULT_ALGORITHM)},
+       {"sort", SORT_METHOD_HELP,
+        cxxopts::value<std::string>()->default_value(DEFAULT_SORT_METHOD)},
+       {"io",
+        "Edge loading: collective (every rank reads its share with MPI-IO) "
+        "or root (rank 0 reads and sends)",
+        cxxopts::value<std::string>()->default_value(DEFAULT_IO_MODE)},
+       {"reduce",
+        "Forest reduction: tree (binomial tree of pairwise merges), gather "
+        "(rank 0 merges all forests at once) or stream (rank 0 merges each "
+        "forest as it arrives)",
+        cxxopts::value<std::string>()->default_value(DEFAULT_REDUCE_MODE)},
+       {"shm",
+        "Share each node's edges and forests through MPI shared-memory "
+        "windows; only one rank per node communicates across nodes",
+        cxxopts::value<bool>()->default_value("false")},
+       {"pipeline",
+        "Overlap communication with compute: chunked nonblocking sends for "
+        "--io root, merge-on-arrival for --reduce gather",
+        cxxopts::value<bool>()->default_value("false")},
+       {"chunkEdges", "Edges per message with --pipeline",
+        cxxopts::value<size_t>()->default_value(DEFAULT_CHUNK_EDGES)},
+       {"compress",
+        "Send edges delta + varint encoded instead of as raw records",
+        cxxopts::value<bool>()->default_value("false")}});
   auto cl_options = options.parse(argc, argv);
   std::string input_file_path = cl_options["inputFile"].as<std::string>();
+  uint n_threads = std::max(1u, cl_options["nThreads"].as<uint>());
+  if (thread_support < MPI_THREAD_FUNNELED && n_threads > 1) {
+    if (rank == 0) {
+      std::cout << "The MPI library does not support threads; running with "
+                   "nThreads 1"
+                << std::endl;
+    }
+    n_threads = 1;
+  }
+  std::string algorithm = cl_options["algo"].as<std::string>();
+  if (algorithm != "kruskal" && algorithm != "boruvka") {
+    if (rank == 0) std::cout << "algo must be kruskal or boruvka!" << std::endl;
+    MPI_Finalize();
+    return -1;
+  }
+  std::string io_mode = cl_options["io"].as<std::string>();
+  if (io_mode != "collective" && io_mode != "root") {
+    if (rank == 0) std::cout << "io must be collective or root!" << std::endl;
+    MPI_Finalize();
+    return -1;
+  }
+  bool pipeline = cl_options["pipeline"].as<bool>();
+  bool compress = cl_options["compress"].as<bool>();
+  size_t chunk_edges =
+      std::max<size_t>(1, cl_options["chunkEdges"].as<size_t>());
+  std::string reduce_mode = cl_options["reduce"].as<std::string>();
+  if (reduce_mode != "tree" && reduce_mode != "gather" &&
+      reduce_mode != "stream") {
+    if (rank == 0) {
+      std::cout << "reduce must be tree, gather or stream!" << std::endl;
+    }
+    MPI_Finalize();
+    return -1;
+  }
+  bool shm = cl_options["shm"].as<bool>();
+  if (shm && io_mode != "collective") {
+    if (rank == 0) std::cout << "shm needs io collective!" << std::endl;
+    MPI_Finalize();
+    return -1;
+  }
+  SortMethod sort_method;
+  if (!parseSortMethod(cl_options["sort"].as<std::string>(), sort_method)) {
+    if (rank == 0) std::cout << "Unknown sort method!" << std::endl;
+    MPI_Finalize();
+    return -1;
+  }
+
+  // Loading, the local sorts and the local MSF run on this pool.
+  ThreadPool pool(n_threads);
+  ThreadPool::current() = &pool;
 
+  MPI_Datatype edge_type = create_edge_datatype();
   Graph g;
-  if (rank == 0) {
-    g.readGraphFromTextFile(input_file_path);
+  std::vector<edge_t> local_edges;
+  // With --shm the forest reduction runs among the node leaders only, and
+  // this rank's edges are a slice of the node's shared window.
+  NodeGroup *node = shm ? new NodeGroup(rank) : nullptr;
+  EdgeWire wire(compress, edge_type, shm ? node->leader_comm : MPI_COMM_WORLD);
+  int reduce_rank = shm ? node->leader_rank : rank;
+  int reduce_size = shm ? node->leader_size : size;
+  MPI_Win node_window = MPI_WIN_NULL;
+  // Every exit from here on, failed or not, releases the MPI objects above
+  // before MPI_Finalize.
+  auto finish = [&](int exit_code) {
+    if (node_window != MPI_WIN_NULL) MPI_Win_free(&node_window);
+    if (shm) {
+      node->free();
+      delete node;
+    }
+    MPI_Type_free(&edge_type);
+    MPI_Finalize();
+    return exit_code;
+  };
+  const edge_t *slice = nullptr;
+  size_t slice_size = 0;
+  if (shm) {
+    const edge_t *node_edges;
+    size_t node_m;
+    if (!load_node_edges(input_file_path, g, *node, node_window, node_edges,
+                         node_m)) {
+      return finish(2);
+    }
+    std::vector<int> counts, displs;
+    partition_edges(node_m, node->node_size, counts, displs);
+    slice = node_edges + displs[node->node_rank];
+    slice_size = counts[node->node_rank];
+  } else if (io_mode == "collective") {
+    if (!read_graph_collective(input_file_path, g, local_edges, rank, size,
+                               MPI_COMM_WORLD)) {
+      return finish(2);
+    }
+  } else if (rank == 0) {
+    g.readGraph(input_file_path);
   }
   timer main_time;
   main_time.start();
-  MPI_Bcast(&g.n_, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
-  MPI_Bcast(&g.m_, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
-  std::vector<edge_t> local_edges(5);
-  if (rank == 0) {
-    for (int i = 1; i < size; i++) {
-      std::vector<edge_t> proc_edges;
-      distribute_edges(g, proc_edges, i, size);
-      MPI_Send(proc_edges.data(), proc_edges.size() * sizeof(edge_t), MPI_BYTE,
-               i, 0, MPI_COMM_WORLD);
-    }
-    distribute_edges(g, local_edges, rank, size);
-  } else {
-    int recv_size = (g.m_ / size) + (rank < g.m_ % size ? 1 : 0);
-    local_edges.resize(recv_size);
-    MPI_Recv(local_edges.data(), recv_size * sizeof(edge_t), MPI_BYTE, 0, 0,
-             MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+  if (io_mode == "root") {
+    MPI_Bcast(&g.n_, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&g.m_, 1, MPI_UINT32_T, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&g.sorted_by_weight_, 1, MPI_CXX_BOOL, 0, MPI_COMM_WORLD);
   }
-
-  std::vector<edge_t> mst_edges_local;
-  MSTData localResult = mst_parallel_worker(g, local_edges, mst_edges_local);
-  int local_size = mst_edges_local.size();
-  std::vector<int> sizes;
-  if (rank == 0) {
-    sizes.resize(size);
+  // The pipelined Kruskal path distributes the edges itself.
+  bool pipelined_distribution =
+      io_mode == "root" && pipeline && algorithm == "kruskal";
+  if (io_mode == "root" && !pipelined_distribution) {
+    // Every rank derives the same split from m, and rank 0 scatters its
+    // blocks straight out of g.edges.
+    std::vector<int> counts, displs;
+    partition_edges(g.m_, size, counts, displs);
+    wire.scatter(g.edges.data(), counts, displs, local_edges, rank);
   }
-  MPI_Gather(&local_size, 1, MPI_INT, sizes.data(), 1, MPI_INT, 0,
-             MPI_COMM_WORLD);
 
+  std::vector<edge_t> mst_edges_local;
+  MSTData localResult;
   std::vector<edge_t> final;
-  if (rank == 0) {
-    for (int i = 0; i < size; ++i) {
-      std::vector<edge_t> temp(sizes[i]);
-      if (i == 0) {
-        std::copy(mst_edges_local.begin(), mst_edges_local.end(),
-                  std::back_inserter(final));
-      } else {
-        MPI_Recv(temp.data(), sizes[i] * sizeof(edge_t), MPI_BYTE, i, 0,
-                 MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-        std::copy(temp.begin(), temp.end(), std::back_inserter(final));
-      }
+  if (algorithm == "boruvka") {
+    // The vertex-partitioned engine keeps its own copy of the slice and
+    // exchanges over MPI_COMM_WORLD.
+    if (shm) local_edges.assign(slice, slice + slice_size);
+    localResult = mst_boruvka_distributed(g, local_edges, mst_edges_local,
+                                          rank, size, edge_type);
+  } else {
+    if (pipelined_distribution) {
+      localResult =
+          pipelined_local_msf(g, mst_edges_local, sort_method, n_threads,
+                              chunk_edges, rank, size, wire);
+    } else if (shm) {
+      timer t;
+      t.start();
+      reduce_edges_to_forest(g, slice, slice_size, sort_method, n_threads,
+                             mst_edges_local);
+      localResult = forest_statistics(mst_edges_local, t.stop());
+      merge_node_forests(mst_edges_local, g.n_, *node);
+    } else {
+      localResult = mst_parallel_worker(g, local_edges, mst_edges_local,
+                                        sort_method, n_threads);
+    }
+    // Under --shm the other ranks' forests already went to their node
+    // leader through shared memory.
+    bool reduces = !shm || node->isLeader();
+    if (reduces && reduce_mode == "tree") {
+      reduce_forests_tree(mst_edges_local, g.n_, reduce_rank, reduce_size,
+                          wire);
+      if (rank == 0) final.swap(mst_edges_local);
+    } else if (reduces && (reduce_mode == "stream" || pipeline)) {
+      stream_forests_to_root(mst_edges_local, g.n_, reduce_rank, reduce_size,
+                             wire);
+      if (rank == 0) final.swap(mst_edges_local);
+    } else if (reduces) {
+      wire.gather(mst_edges_local, final, reduce_rank, reduce_size);
     }
   }
-  if (rank != 0) {
-    MPI_Send(mst_edges_local.data(), local_size * sizeof(edge_t), MPI_BYTE, 0,
-             0, MPI_COMM_WORLD);
+
+  // Boruvka's MSF stays spread over the ranks; only its totals are summed.
+  unsigned long local_totals[2] = {localResult.edges_processed,
+                                   localResult.weight_sum};
+  unsigned long boruvka_totals[2] = {0, 0};
+  if (algorithm == "boruvka") {
+    MPI_Reduce(local_totals, boruvka_totals, 2, MPI_UNSIGNED_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
+  }
+  unsigned long long local_wire[2] = {wire.raw_bytes, wire.encoded_bytes};
+  unsigned long long wire_totals[2] = {0, 0};
+  if (wire.compressed()) {
+    MPI_Reduce(local_wire, wire_totals, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0,
+               MPI_COMM_WORLD);
   }
 
   std::vector<MSTData> allData;
-  std::vector<int> displs(size, 0);
   if (rank == 0) {
     allData.resize(size);
   }
@@ -157,7 +1235,18 @@ int main(int argc, char *argv[]) {
              sizeof(MSTData), MPI_BYTE, 0, MPI_COMM_WORLD);
   if (rank == 0) {
     uint count = 1;
-    uintE total_weight = calculate_local_mst_weight(final, g.n_, count);
+    uintE total_weight = 0;
+    if (algorithm == "boruvka") {
+      count += boruvka_totals[0];
+      total_weight = boruvka_totals[1];
+    } else if (reduce_mode != "gather" || pipeline) {
+      // The reduction already left the MSF on rank 0.
+      for (const auto &edge : final) total_weight += edge.weight;
+      count += final.size();
+    } else {
+      total_weight =
+          calculate_local_mst_weight(final, g.n_, count, sort_method);
+    }
     double total_time = main_time.stop();
     std::cout << "Statistics" << std::endl;
     std::cout << "Total number of vertices in the graph: " << g.n_ << std::endl;
@@ -170,9 +1259,13 @@ int main(int argc, char *argv[]) {
     std::cout << "Number of vertices in the MST: " << count << std::endl;
     std::cout << "Total weight of the MST: " << total_weight << std::endl;
     std::cout << "Time taken (in seconds) : " << total_time << std::endl;
+    if (wire.compressed() && wire_totals[1] > 0) {
+      std::cout << "Wire compression ratio: "
+                << double(wire_totals[0]) / wire_totals[1] << " ("
+                << wire_totals[0] << " raw bytes sent as " << wire_totals[1]
+                << ")" << std::endl;
+    }
   }
 
-  MPI_Finalize();
-
-  return 0;
+  return finish(0);
 }
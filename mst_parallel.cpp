@@ -1,19 +1,23 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <set>
-#include <thread>
 #include <vector>
 
+#include "core/edge_sort.h"
 #include "core/graph.h"
+#include "core/multiway_merge.h"
+#include "core/thread_pool.h"
 #include "core/utils.h"
 
 #define DEFAULT_NUMBER_OF_THREADS "1"
-
-std::mutex union_find_mutex;
+#define DEFAULT_FILE_PATH "input_graph/graph.txt"
+#define DEFAULT_ALGORITHM "kruskal"
+#define NO_EDGE UINT64_MAX
 
 struct ThreadResult {
   uintE edges_processed;
@@ -24,91 +28,95 @@ struct ThreadResult {
       : edges_processed(0), weight_sum(0), time_taken(0), num_edges(0) {}
 };
 
-void mst_parallel_worker(Graph &g, UnionFind &union_find,
-                         const std::vector<edge_t> &edges_subset,
+void mst_parallel_worker(Graph &g, const std::vector<edge_t> &edges_subset,
                          std::vector<edge_t> &mst_edges_local,
+                         SortMethod sort_method, uint sort_threads,
                          ThreadResult &result) {
   std::vector<edge_t> sorted_edges_subset = edges_subset;
-  std::sort(sorted_edges_subset.begin(), sorted_edges_subset.end(),
-            [](edge_t &a, edge_t &b) { return a.weight < b.weight; });
+  if (!g.sorted_by_weight_) {
+    sortEdgesByWeight(sorted_edges_subset.data(), sorted_edges_subset.size(),
+                      sort_method, sort_threads);
+  }
 
   timer t1;
   t1.start();
+  // Sized to this partition's endpoints rather than to all g.n_ vertices.
+  SparseUnionFind union_find(
+      std::min<size_t>(g.n_, 2 * sorted_edges_subset.size()));
   for (auto &edge : sorted_edges_subset) {
-    std::lock_guard<std::mutex> guard(union_find_mutex);
-    uintV root1 = union_find.find(edge.from);
-    uintV root2 = union_find.find(edge.to);
     result.num_edges++;
-    if (root1 != root2) {
+    if (union_find.unite(edge.from, edge.to)) {
       mst_edges_local.push_back(edge);
-      union_find.merge(root1, root2);
       result.edges_processed++;
       result.weight_sum += edge.weight;
     }
   }
-  result.time_taken = t1.stop();
+  result.time_taken += t1.stop();
 }
 
-void merge_local_msts(std::vector<edge_t> &mst_edges,
-                      const std::vector<std::vector<edge_t>> &mst_edges_local,
-                      UnionFind &union_find) {
-  std::vector<edge_t> all_edges;
-  for (const auto &local_edges : mst_edges_local) {
-    all_edges.insert(all_edges.end(), local_edges.begin(), local_edges.end());
+// mst_parallel_worker on the columnar edges [start, end): only the weight
+// column is sorted, as an index permutation, and the endpoints are read in
+// that order during the scan.
+void mst_parallel_worker_columns(Graph &g, const EdgeColumns &columns,
+                                 size_t start, size_t end,
+                                 std::vector<edge_t> &mst_edges_local,
+                                 SortMethod sort_method, uint sort_threads,
+                                 ThreadResult &result) {
+  std::vector<uint32_t> order;
+  if (g.sorted_by_weight_) {
+    order.resize(end - start);
+    for (size_t i = 0; i < order.size(); i++) order[i] = i;
+  } else {
+    sortEdgeOrderByWeight(columns.weight.data() + start, end - start,
+                          sort_method, sort_threads, order);
   }
 
-  std::sort(
-      all_edges.begin(), all_edges.end(),
-      [](const edge_t &a, const edge_t &b) { return a.weight < b.weight; });
-
-  for (const auto &edge : all_edges) {
-    uintV root1 = union_find.find(edge.from);
-    uintV root2 = union_find.find(edge.to);
-
-    if (root1 != root2) {
-      mst_edges.push_back(edge);
-      union_find.merge(root1, root2);
+  timer t1;
+  t1.start();
+  SparseUnionFind union_find(std::min<size_t>(g.n_, 2 * (end - start)));
+  for (uint32_t i : order) {
+    size_t e = start + i;
+    result.num_edges++;
+    if (union_find.unite(columns.from[e], columns.to[e])) {
+      mst_edges_local.push_back(columns.edge(e));
+      result.edges_processed++;
+      result.weight_sum += columns.weight[e];
     }
   }
+  result.time_taken += t1.stop();
 }
 
-void mst_parallel(Graph &g, uint n_threads) {
-  UnionFind union_find(g.n_);
-  std::vector<edge_t> mst_edges;
-  timer t1;
-  double time_taken = 0.0;
-
-  t1.start();
-
-  std::vector<std::thread> threads;
-  std::vector<std::vector<edge_t>> mst_edges_local(n_threads);
-  std::vector<ThreadResult> results(n_threads);
-  std::vector<UnionFind> union_finds(n_threads, UnionFind(g.n_));
-
-  uintE total_edges = g.edges.size();
-  uintE base_edges_per_thread = total_edges / n_threads;
-  uintE remainder = total_edges % n_threads;
-
-  uintV start = 0;
-  for (uint i = 0; i < n_threads; i++) {
-    uintE num_edges_assigned = base_edges_per_thread + (i < remainder ? 1 : 0);
-    uintV end = start + num_edges_assigned;
-
-    threads.emplace_back(
-        mst_parallel_worker, std::ref(g), std::ref(union_finds[i]),
-        std::vector<edge_t>(g.edges.begin() + start, g.edges.begin() + end),
-        std::ref(mst_edges_local[i]), std::ref(results[i]));
-
-    start = end;
-  }
-  for (auto &thread : threads) {
-    thread.join();
+// Kruskal over the union of the local MSFs. Every worker emits its forest in
+// weight order, so a LoserTree merge of the forests feeds the union-find
+// directly instead of concatenating them and sorting the copy again, and it
+// stops once the tree has n - 1 edges.
+void merge_local_msts(std::vector<edge_t> &mst_edges,
+                      const std::vector<std::vector<edge_t>> &mst_edges_local,
+                      UnionFind &union_find, uintV num_vertices) {
+  size_t k = mst_edges_local.size();
+  std::vector<size_t> next(k, 0);
+  LoserTree<edge_t, EdgeWeightLess> tree(k, edge_weight_less);
+  for (size_t i = 0; i < k; i++) {
+    if (!mst_edges_local[i].empty()) tree.setKey(i, mst_edges_local[i][0]);
   }
+  tree.build();
 
-  merge_local_msts(mst_edges, mst_edges_local, union_find);
-
-  time_taken = t1.stop();
+  size_t target = num_vertices > 0 ? num_vertices - 1 : 0;
+  while (!tree.empty() && mst_edges.size() < target) {
+    size_t i = tree.winner();
+    const edge_t &edge = mst_edges_local[i][next[i]++];
+    if (union_find.unite(edge.from, edge.to)) mst_edges.push_back(edge);
+    if (next[i] < mst_edges_local[i].size()) {
+      tree.replaceWinner(mst_edges_local[i][next[i]]);
+    } else {
+      tree.exhaustWinner();
+    }
+  }
+}
 
+void print_statistics(const Graph &g, const std::vector<edge_t> &mst_edges,
+                      const std::vector<ThreadResult> &results,
+                      double time_taken) {
   std::cout << "Printing statistics..." << std::endl;
   std::cout << "Total number of vertices in the graph: " << g.n_ << std::endl;
   std::set<uintV> vertices_in_mst;
@@ -117,7 +125,7 @@ void mst_parallel(Graph &g, uint n_threads) {
     vertices_in_mst.insert(edge.to);
   }
 
-  for (uint i = 0; i < n_threads; ++i) {
+  for (uint i = 0; i < results.size(); ++i) {
     std::cout << "Thread " << i
               << ": Edges processed: " << results[i].edges_processed
               << ", Total weight: " << results[i].weight_sum
@@ -135,24 +143,253 @@ void mst_parallel(Graph &g, uint n_threads) {
   std::cout << "Time taken (in seconds) : " << time_taken << std::endl;
 }
 
+void mst_parallel(Graph &g, uint n_threads, SortMethod sort_method,
+                  EdgeLayout layout) {
+  UnionFind union_find(g.n_);
+  std::vector<edge_t> mst_edges;
+  timer t1;
+  double time_taken = 0.0;
+
+  t1.start();
+
+  // One local MSF per partition. parallel_for chooses the partitions at run
+  // time, so a worker that finishes early splits off part of a busy
+  // worker's range instead of idling; results are summed per worker.
+  std::vector<std::vector<edge_t>> mst_edges_local;
+  std::mutex mst_edges_local_mutex;
+  std::vector<ThreadResult> results(parallel_workers(n_threads));
+  auto add_local_msf = [&](std::vector<edge_t> &&forest) {
+    std::lock_guard<std::mutex> guard(mst_edges_local_mutex);
+    mst_edges_local.push_back(std::move(forest));
+  };
+
+  // Radix sort blocks are pool tasks, so a worker that finishes early steals
+  // pieces of the others' sorts. quickSort would start a separate OpenMP team
+  // per worker instead, so it and std::sort stay sequential per partition.
+  uint sort_threads =
+      (sort_method == RADIX_SORT || sort_method == RADIX_SORT_KEYS) ? n_threads
+                                                                    : 1;
+
+  if (layout == SOA_LAYOUT) {
+    const EdgeColumns &columns = g.getColumns(n_threads);
+    parallel_for(
+        n_threads, columns.size(), [&](uint i, size_t start, size_t end) {
+          std::vector<edge_t> forest;
+          mst_parallel_worker_columns(g, columns, start, end, forest,
+                                      sort_method, sort_threads, results[i]);
+          add_local_msf(std::move(forest));
+        });
+  } else {
+    parallel_for(
+        n_threads, g.edges.size(), [&](uint i, size_t start, size_t end) {
+          std::vector<edge_t> forest;
+          mst_parallel_worker(
+              g,
+              std::vector<edge_t>(g.edges.begin() + start,
+                                  g.edges.begin() + end),
+              forest, sort_method, sort_threads, results[i]);
+          add_local_msf(std::move(forest));
+        });
+  }
+
+  merge_local_msts(mst_edges, mst_edges_local, union_find, g.n_);
+
+  time_taken = t1.stop();
+
+  print_statistics(g, mst_edges, results, time_taken);
+}
+
+// Lowers the (weight, edge index) key in best to key if key is smaller.
+inline void write_min(std::atomic<uint64_t> &best, uint64_t key) {
+  uint64_t current = best.load(std::memory_order_relaxed);
+  while (key < current &&
+         !best.compare_exchange_weak(current, key, std::memory_order_relaxed)) {
+  }
+}
+
+// One thread of the Borůvka engine. Thread tid owns the vertex block
+// [v_start, v_end) and the edges in [e_start, e_start + e_sizes[tid]).
+// Each round:
+//   1. every component picks its lightest incident edge, ties broken by edge
+//      index so all threads agree on the choice;
+//   2. every component root unites with the component across that edge in
+//      the shared lock-free union-find; the chosen edges form a forest, so a
+//      unite only fails when the other side already added the same edge;
+//   3. vertices take their new labels from find(), whose path halving
+//      flattens the hooks;
+//   4. each thread drops the edges of its segment that became internal.
+// Phases are separated by the shared barrier, and the loop stops once no
+// thread has edges left.
+void boruvka_worker(uint tid, uint n_threads, std::vector<edge_t> &edges,
+                    size_t e_start, std::vector<size_t> &e_sizes,
+                    uintV v_start, uintV v_end, std::vector<uintV> &comp,
+                    ConcurrentUnionFind &union_find,
+                    std::vector<std::atomic<uint64_t>> &best,
+                    SpinBarrier &barrier, std::vector<edge_t> &mst_edges_local,
+                    ThreadResult &result) {
+  timer t1;
+  t1.start();
+  while (true) {
+    for (uintV v = v_start; v < v_end; v++) {
+      best[v].store(NO_EDGE, std::memory_order_relaxed);
+    }
+    barrier.wait();
+
+    size_t e_end = e_start + e_sizes[tid];
+    for (size_t i = e_start; i < e_end; i++) {
+      uintV c1 = comp[edges[i].from];
+      uintV c2 = comp[edges[i].to];
+      if (c1 == c2) continue;
+      // radix_weight_key orders negative weights first, as the sorts do.
+      uint64_t key = (uint64_t(radix_weight_key(edges[i].weight)) << 32) | i;
+      write_min(best[c1], key);
+      write_min(best[c2], key);
+    }
+    result.num_edges += e_sizes[tid];
+    barrier.wait();
+
+    for (uintV v = v_start; v < v_end; v++) {
+      uint64_t key = best[v].load(std::memory_order_relaxed);
+      if (comp[v] != v || key == NO_EDGE) continue;
+      const edge_t &edge = edges[key & 0xFFFFFFFF];
+      if (union_find.unite(edge.from, edge.to)) {
+        mst_edges_local.push_back(edge);
+        result.edges_processed++;
+        result.weight_sum += edge.weight;
+      }
+    }
+    barrier.wait();
+
+    for (uintV v = v_start; v < v_end; v++) {
+      comp[v] = union_find.find(v);
+    }
+    barrier.wait();
+
+    size_t kept = e_start;
+    for (size_t i = e_start; i < e_end; i++) {
+      if (comp[edges[i].from] != comp[edges[i].to]) {
+        edges[kept++] = edges[i];
+      }
+    }
+    e_sizes[tid] = kept - e_start;
+    barrier.wait();
+    bool edges_left = false;
+    for (uint i = 0; i < n_threads; i++) {
+      if (e_sizes[i] > 0) edges_left = true;
+    }
+    if (!edges_left) break;
+  }
+  result.time_taken = t1.stop();
+}
+
+void mst_boruvka(Graph &g, uint n_threads) {
+  std::vector<edge_t> mst_edges;
+  timer t1;
+  double time_taken = 0.0;
+
+  t1.start();
+
+  std::vector<edge_t> edges(g.edges.begin(), g.edges.end());
+  std::vector<uintV> comp(g.n_);
+  for (uintV v = 0; v < g.n_; v++) {
+    comp[v] = v;
+  }
+  ConcurrentUnionFind union_find(g.n_);
+  std::vector<std::atomic<uint64_t>> best(g.n_);
+  std::vector<size_t> e_sizes(n_threads);
+  std::vector<std::vector<edge_t>> mst_edges_local(n_threads);
+  std::vector<ThreadResult> results(n_threads);
+  SpinBarrier barrier(n_threads);
+
+  parallel_run(n_threads, [&](uint i) {
+    size_t e_base = edges.size() / n_threads;
+    size_t e_remainder = edges.size() % n_threads;
+    size_t e_start = i * e_base + std::min<size_t>(i, e_remainder);
+    e_sizes[i] = e_base + (i < e_remainder ? 1 : 0);
+    uintV v_base = g.n_ / n_threads;
+    uintV v_remainder = g.n_ % n_threads;
+    uintV v_start = i * v_base + std::min<uintV>(i, v_remainder);
+    uintV v_end = v_start + v_base + (i < v_remainder ? 1 : 0);
+    // Segment sizes must all be set before any thread starts round one.
+    barrier.wait();
+    boruvka_worker(i, n_threads, edges, e_start, e_sizes, v_start, v_end, comp,
+                   union_find, best, barrier, mst_edges_local[i], results[i]);
+  });
+
+  for (const auto &local_edges : mst_edges_local) {
+    mst_edges.insert(mst_edges.end(), local_edges.begin(), local_edges.end());
+  }
+
+  time_taken = t1.stop();
+
+  print_statistics(g, mst_edges, results, time_taken);
+}
+
 int main(int argc, char *argv[]) {
   Graph g;
   cxxopts::Options options("MST_Parallel", "Minimum Spanning Tree Algorithm");
   options.add_options(
       "custom",
       {{"nThreads", "Number of threads",
-        cxxopts::value<uint>()->default_value(DEFAULT_NUMBER_OF_THREADS)}});
+        cxxopts::value<uint>()->default_value(DEFAULT_NUMBER_OF_THREADS)},
+       {"algo", "MST algorithm: kruskal or boruvka",
+        cxxopts::value<std::string>()->default_value(DEFAULT_ALGORITHM)},
+       {"sort", SORT_METHOD_HELP,
+        cxxopts::value<std::string>()->default_value(DEFAULT_SORT_METHOD)},
+       {"layout", EDGE_LAYOUT_HELP,
+        cxxopts::value<std::string>()->default_value(DEFAULT_EDGE_LAYOUT)},
+       {"overlapLoad",
+        "Sort blocks of edges while the rest of the input is still being "
+        "parsed, then merge them",
+        cxxopts::value<bool>()->default_value("false")},
+       {"inputFile", "Input file path (text or binary edge list)",
+        cxxopts::value<std::string>()->default_value(DEFAULT_FILE_PATH)}});
   auto cl_options = options.parse(argc, argv);
   uint n_threads = cl_options["nThreads"].as<uint>();
+  std::string input_file_path = cl_options["inputFile"].as<std::string>();
+  std::string algorithm = cl_options["algo"].as<std::string>();
+  if (algorithm != "kruskal" && algorithm != "boruvka") {
+    std::cout << "algo must be kruskal or boruvka!" << std::endl;
+    return -1;
+  }
+  SortMethod sort_method;
+  if (!parseSortMethod(cl_options["sort"].as<std::string>(), sort_method)) {
+    std::cout << "Unknown sort method!" << std::endl;
+    return -1;
+  }
+  EdgeLayout layout;
+  if (!parseEdgeLayout(cl_options["layout"].as<std::string>(), layout)) {
+    std::cout << "Unknown edge layout!" << std::endl;
+    return -1;
+  }
 
-  g.readGraphFromTextFile("input_graph/graph.txt");
+  // Loading, sorting, the local MSFs and the merge all run on this pool.
+  ThreadPool pool(n_threads);
+  ThreadPool::current() = &pool;
+
+  if (cl_options["overlapLoad"].as<bool>()) {
+    timer load_time;
+    load_time.start();
+    g.readGraphSorted(input_file_path, n_threads,
+                      [sort_method](edge_t *edges, size_t n) {
+                        sortEdgesByWeight(edges, n, sort_method);
+                      });
+    std::cout << "Load and sort time (in seconds) : " << load_time.stop()
+              << std::endl;
+  } else {
+    g.readGraph(input_file_path);
+  }
 
   if (n_threads > g.edges.size()) {
     std::cout << "nThreads must be less than number of edges!" << std::endl;
     return -1;
   }
 
-  mst_parallel(std::ref(g), n_threads);
+  if (algorithm == "boruvka") {
+    mst_boruvka(std::ref(g), n_threads);
+  } else {
+    mst_parallel(std::ref(g), n_threads, sort_method, layout);
+  }
 
   return 0;
 }
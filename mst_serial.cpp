@@ -5,39 +5,117 @@
 #include <iostream>
 #include <set>
 
+#include "core/edge_sort.h"
+#include "core/external_sort.h"
 #include "core/graph.h"
+#include "core/multiway_merge.h"
+#include "core/quick_sort.h"
 #include "core/utils.h"
 
-void mst_serial(Graph &g) {
-  UnionFind union_find(g.n_);
-  std::vector<edge_t> mst_edges;
-  timer t1;
-  double time_taken = 0.0;
-
-  t1.start();
+#define DEFAULT_FILE_PATH "input_graph/graph.txt"
+#define DEFAULT_ALGORITHM "kruskal"
+// Below this many edges Filter-Kruskal just sorts and scans.
+#define FILTER_KRUSKAL_CUTOFF 1024
+#define DEFAULT_CHUNK_EDGES "16777216"
 
-  std::sort(g.edges.begin(), g.edges.end(),
-            [](edge_t &a, edge_t &b) { return a.weight < b.weight; });
-
-  for (auto edge : g.edges) {
-    uintV root1 = union_find.find(edge.from);
-    uintV root2 = union_find.find(edge.to);
+// Kruskal's scan over edges that are already in weight order. Stops once the
+// tree has target edges.
+void kruskal_scan(const edge_t *edges, size_t n, UnionFind &union_find,
+                  std::vector<edge_t> &mst_edges, size_t target) {
+  for (size_t i = 0; i < n && mst_edges.size() < target; i++) {
+    uintV root1 = union_find.find(edges[i].from);
+    uintV root2 = union_find.find(edges[i].to);
 
     if (root1 != root2) {
-      mst_edges.push_back(edge);
+      mst_edges.push_back(edges[i]);
       union_find.merge(root1, root2);
+    }
+  }
+}
 
-      if (mst_edges.size() == g.n_ - 1) {
-        break;
-      }
+// kruskal_scan over columnar edges, visiting them in the given order.
+void kruskal_scan_columns(const EdgeColumns &columns, const uint32_t *order,
+                          size_t n, UnionFind &union_find,
+                          std::vector<edge_t> &mst_edges, size_t target) {
+  for (size_t i = 0; i < n && mst_edges.size() < target; i++) {
+    uint32_t e = order[i];
+    if (union_find.unite(columns.from[e], columns.to[e])) {
+      mst_edges.push_back(columns.edge(e));
     }
   }
+}
 
-  time_taken = t1.stop();
+// Filter-Kruskal: partition around a pivot weight, solve the light part
+// first, then drop heavy edges whose endpoints it already connected before
+// recursing on what is left. Heavy edges are only sorted if they survive.
+void filter_kruskal(edge_t *edges, size_t n, UnionFind &union_find,
+                    std::vector<edge_t> &mst_edges, size_t target) {
+  if (mst_edges.size() >= target) return;
+  if (n <= FILTER_KRUSKAL_CUTOFF) {
+    quickSort(edges, n, edge_weight_less);
+    kruskal_scan(edges, n, union_find, mst_edges, target);
+    return;
+  }
+
+  edge_t pivot =
+      median(edges[n / 4], edges[n / 2], edges[(3 * n) / 4], edge_weight_less);
+  edge_t *equal_begin, *heavy_begin;
+  partition3(edges, n, pivot, edge_weight_less, &equal_begin, &heavy_begin);
+
+  filter_kruskal(edges, equal_begin - edges, union_find, mst_edges, target);
+  kruskal_scan(equal_begin, heavy_begin - equal_begin, union_find, mst_edges,
+               target);
+  if (mst_edges.size() >= target) return;
+
+  edge_t *heavy_end = edges + n;
+  edge_t *kept = heavy_begin;
+  for (edge_t *edge = heavy_begin; edge < heavy_end; edge++) {
+    if (union_find.find(edge->from) != union_find.find(edge->to)) {
+      *kept++ = *edge;
+    }
+  }
+  filter_kruskal(heavy_begin, kept - heavy_begin, union_find, mst_edges,
+                 target);
+}
+
+// Prim's algorithm over the CSR rows of the graph, with a binary heap of the
+// edges leaving the tree. Every unvisited vertex starts a new tree, so a
+// disconnected graph yields its minimum spanning forest. The heap may hold
+// stale edges into vertices reached since they were pushed; those are
+// dropped when popped.
+void prim(const CSRGraph &csr, std::vector<edge_t> &mst_edges) {
+  uintV n = csr.numVertices();
+  auto heavier = [](const edge_t &a, const edge_t &b) {
+    return edge_weight_less(b, a);
+  };
+  std::vector<bool> in_tree(n, false);
+  std::vector<edge_t> heap;
+  auto add_vertex = [&](uintV v) {
+    in_tree[v] = true;
+    for (uint64_t i = csr.offsets[v]; i < csr.offsets[v + 1]; i++) {
+      if (in_tree[csr.neighbors[i]]) continue;
+      heap.emplace_back(v, csr.neighbors[i], csr.weights[i]);
+      std::push_heap(heap.begin(), heap.end(), heavier);
+    }
+  };
+  for (uintV root = 0; root < n; root++) {
+    if (in_tree[root]) continue;
+    add_vertex(root);
+    while (!heap.empty()) {
+      std::pop_heap(heap.begin(), heap.end(), heavier);
+      edge_t edge = heap.back();
+      heap.pop_back();
+      if (in_tree[edge.to]) continue;
+      mst_edges.push_back(edge);
+      add_vertex(edge.to);
+    }
+  }
+}
 
-  // Print statistics
+void print_statistics(uintV n, const std::vector<edge_t> &mst_edges,
+                      double time_taken) {
   std::cout << "Printing statistics..." << std::endl;
-  std::cout << "Total number of vertices in the graph: " << g.n_ << std::endl;
+  std::cout << "Total number of vertices in the graph: " << n << std::endl;
   std::set<uintV> vertices_in_mst;
   for (auto edge : mst_edges) {
     vertices_in_mst.insert(edge.from);
@@ -53,11 +131,283 @@ void mst_serial(Graph &g) {
   std::cout << "Time taken (in seconds) : " << time_taken << std::endl;
 }
 
-int main() {
+// Most edges a spanning forest of num_vertices vertices can have; the scans
+// stop there. An empty graph has none.
+size_t spanning_edges(uintV num_vertices) {
+  return num_vertices > 0 ? num_vertices - 1 : 0;
+}
+
+void mst_serial(Graph &g, const std::string &algorithm,
+                SortMethod sort_method, EdgeLayout layout) {
+  UnionFind union_find(g.n_);
+  std::vector<edge_t> mst_edges;
+  timer t1;
+  double time_taken = 0.0;
+  size_t target = spanning_edges(g.n_);
+
+  t1.start();
+
+  if (layout == SOA_LAYOUT) {
+    const EdgeColumns &columns = g.getColumns(1);
+    std::vector<uint32_t> order;
+    if (g.sorted_by_weight_) {
+      order.resize(columns.size());
+      for (size_t i = 0; i < order.size(); i++) order[i] = i;
+    } else {
+      sortEdgeOrderByWeight(columns.weight.data(), columns.size(),
+                            sort_method, 1, order);
+    }
+    kruskal_scan_columns(columns, order.data(), order.size(), union_find,
+                         mst_edges, target);
+  } else if (algorithm == "prim") {
+    prim(g.getCSR(1), mst_edges);
+  } else if (algorithm == "filter_kruskal" && !g.sorted_by_weight_) {
+    filter_kruskal(g.edges.data(), g.edges.size(), union_find, mst_edges,
+                   target);
+  } else {
+    if (!g.sorted_by_weight_) {
+      sortEdgesByWeight(g.edges.data(), g.edges.size(), sort_method);
+    }
+    kruskal_scan(g.edges.data(), g.edges.size(), union_find, mst_edges,
+                 target);
+  }
+
+  time_taken = t1.stop();
+
+  print_statistics(g.n_, mst_edges, time_taken);
+}
+
+// Reports a binary input that EdgeStreamReader stopped reading at an
+// out-of-range edge id. Returns true if it did.
+bool report_bad_edge_ids(const EdgeStreamReader &reader,
+                         const std::string &input_file_path) {
+  if (!reader.badEdgeIds()) return false;
+  std::cout << "Input File: " << input_file_path
+            << " has an unsupported binary header. Terminating" << std::endl;
+  return true;
+}
+
+// --stream: Kruskal over the input read chunk_edges edges at a time, so only
+// one chunk and the forest so far (at most n - 1 edges) are ever in memory.
+// Each chunk is sorted and merged with the weight-ordered forest, and a
+// Kruskal pass over the merge keeps only the MSF of everything read so far;
+// an edge it drops closes a cycle as the heaviest edge and cannot be in the
+// final MSF either. Every chunk costs O(n + chunk_edges) on top of its sort,
+// so chunks should hold well over n edges. Input already in weight order
+// needs no merging: one union-find runs across all chunks and reading stops
+// at n - 1 edges.
+// Returns false if the file cannot be read or has out-of-range edge ids.
+bool mst_stream(const std::string &input_file_path, SortMethod sort_method,
+                size_t chunk_edges) {
+  EdgeStreamReader reader;
+  if (!reader.open(input_file_path)) {
+    std::cout << "Input File: " << input_file_path
+              << " cannot be streamed. Terminating" << std::endl;
+    return false;
+  }
+  UnionFind union_find(0);
+  std::vector<edge_t> chunk, forest, merged;
+  timer t1;
+  t1.start();
+
+  if (reader.sortedByWeight()) {
+    size_t target = spanning_edges(reader.numVertices());
+    while (forest.size() < target && reader.next(chunk, chunk_edges)) {
+      union_find.grow(reader.numVertices());
+      target = spanning_edges(reader.numVertices());
+      kruskal_scan(chunk.data(), chunk.size(), union_find, forest, target);
+    }
+  } else {
+    while (reader.next(chunk, chunk_edges)) {
+      sortEdgesByWeight(chunk.data(), chunk.size(), sort_method);
+      merged.resize(forest.size() + chunk.size());
+      std::merge(forest.begin(), forest.end(), chunk.begin(), chunk.end(),
+                 merged.begin(), edge_weight_less);
+      union_find.reset();
+      union_find.grow(reader.numVertices());
+      forest.clear();
+      kruskal_scan(merged.data(), merged.size(), union_find, forest,
+                   merged.size());
+    }
+  }
+
+  double time_taken = t1.stop();
+  if (report_bad_edge_ids(reader, input_file_path)) return false;
+  report_rejected_lines(input_file_path, reader.rejectedLines());
+  print_statistics(reader.numVertices(), forest, time_taken);
+  return true;
+}
+
+// --external: exact Kruskal over an edge list larger than memory. The input
+// is cut into runs that sort_method can sort within mem_budget bytes (half
+// of it for radix, which needs a second buffer), each spilled to tmp_dir,
+// and a LoserTree merge of the runs feeds the union-find directly, reading
+// each run in blocks that together fill the budget. The merge stops as soon
+// as the tree has n - 1 edges, so heavy edges at the ends of the runs are
+// never read back. Input already sorted by weight is scanned directly.
+// Returns false if the input cannot be read, has out-of-range edge ids, or
+// a run cannot be written.
+bool mst_external(const std::string &input_file_path, SortMethod sort_method,
+                  size_t mem_budget, const std::string &tmp_dir) {
+  EdgeStreamReader reader;
+  if (!reader.open(input_file_path)) {
+    std::cout << "Input File: " << input_file_path
+              << " cannot be streamed. Terminating" << std::endl;
+    return false;
+  }
+  size_t budget_edges = std::max<size_t>(1, mem_budget / sizeof(edge_t));
+  size_t run_edges =
+      std::max<size_t>(1, mem_budget / sortBytesPerEdge(sort_method));
+  std::vector<edge_t> mst_edges;
+  timer t1;
+  t1.start();
+
+  if (reader.sortedByWeight()) {
+    UnionFind union_find(0);
+    std::vector<edge_t> block;
+    size_t target = spanning_edges(reader.numVertices());
+    while (mst_edges.size() < target && reader.next(block, budget_edges)) {
+      union_find.grow(reader.numVertices());
+      target = spanning_edges(reader.numVertices());
+      kruskal_scan(block.data(), block.size(), union_find, mst_edges, target);
+    }
+    double time_taken = t1.stop();
+    if (report_bad_edge_ids(reader, input_file_path)) return false;
+    report_rejected_lines(input_file_path, reader.rejectedLines());
+    print_statistics(reader.numVertices(), mst_edges, time_taken);
+    return true;
+  }
+
+  std::vector<std::string> run_paths;
+  if (!write_sorted_runs(reader, run_edges, tmp_dir, sort_method,
+                         run_paths)) {
+    std::cout << "Cannot write sorted runs to " << tmp_dir << ". Terminating"
+              << std::endl;
+    remove_runs(run_paths);
+    return false;
+  }
+  if (report_bad_edge_ids(reader, input_file_path)) {
+    remove_runs(run_paths);
+    return false;
+  }
+
+  // Every run holds a block being merged and one being read ahead.
+  size_t k = run_paths.size();
+  std::vector<std::unique_ptr<RunReader>> runs(k);
+  LoserTree<edge_t, EdgeWeightLess> tree(k, edge_weight_less);
+  for (size_t i = 0; i < k; i++) {
+    runs[i].reset(new RunReader());
+    if (!runs[i]->open(run_paths[i], budget_edges / (2 * k))) {
+      std::cout << "Cannot read sorted run " << run_paths[i]
+                << ". Terminating" << std::endl;
+      runs.clear();
+      remove_runs(run_paths);
+      return false;
+    }
+    if (!runs[i]->empty()) tree.setKey(i, runs[i]->front());
+  }
+  tree.build();
+
+  UnionFind union_find(reader.numVertices());
+  size_t target = spanning_edges(reader.numVertices());
+  while (!tree.empty() && mst_edges.size() < target) {
+    const edge_t &edge = tree.winnerKey();
+    if (union_find.unite(edge.from, edge.to)) mst_edges.push_back(edge);
+    RunReader &run = *runs[tree.winner()];
+    run.pop();
+    if (run.empty()) {
+      tree.exhaustWinner();
+    } else {
+      tree.replaceWinner(run.front());
+    }
+  }
+  double time_taken = t1.stop();
+  runs.clear();
+  remove_runs(run_paths);
+
+  report_rejected_lines(input_file_path, reader.rejectedLines());
+  print_statistics(reader.numVertices(), mst_edges, time_taken);
+  return true;
+}
+
+int main(int argc, char *argv[]) {
   Graph g;
-  g.readGraphFromTextFile("input_graph/graph.txt");
+  cxxopts::Options options("MST_Serial", "Minimum Spanning Tree Algorithm");
+  options.add_options(
+      "custom",
+      {{"inputFile", "Input file path (text or binary edge list)",
+        cxxopts::value<std::string>()->default_value(DEFAULT_FILE_PATH)},
+       {"algo", "MST algorithm: kruskal, filter_kruskal or prim",
+        cxxopts::value<std::string>()->default_value(DEFAULT_ALGORITHM)},
+       {"sort", SORT_METHOD_HELP,
+        cxxopts::value<std::string>()->default_value(DEFAULT_SORT_METHOD)},
+       {"layout", EDGE_LAYOUT_HELP,
+        cxxopts::value<std::string>()->default_value(DEFAULT_EDGE_LAYOUT)},
+       {"stream",
+        "Read the input in chunks of chunkEdges edges, keeping only the "
+        "current chunk and the forest in memory",
+        cxxopts::value<bool>()->default_value("false")},
+       {"chunkEdges", "Edges per chunk with --stream",
+        cxxopts::value<size_t>()->default_value(DEFAULT_CHUNK_EDGES)},
+       {"external",
+        "Sort the input in memBudget-sized runs on disk and merge them into "
+        "Kruskal's scan",
+        cxxopts::value<bool>()->default_value("false")},
+       {"memBudget", "Memory for runs and merge buffers with --external (MB)",
+        cxxopts::value<size_t>()->default_value(DEFAULT_MEMORY_BUDGET_MB)},
+       {"tmpDir", "Directory for the sorted runs of --external",
+        cxxopts::value<std::string>()->default_value(DEFAULT_TMP_DIR)}});
+  auto cl_options = options.parse(argc, argv);
+  std::string input_file_path = cl_options["inputFile"].as<std::string>();
+  std::string algorithm = cl_options["algo"].as<std::string>();
+  if (algorithm != "kruskal" && algorithm != "filter_kruskal" &&
+      algorithm != "prim") {
+    std::cout << "algo must be kruskal, filter_kruskal or prim!" << std::endl;
+    return -1;
+  }
+  SortMethod sort_method;
+  if (!parseSortMethod(cl_options["sort"].as<std::string>(), sort_method)) {
+    std::cout << "Unknown sort method!" << std::endl;
+    return -1;
+  }
+  EdgeLayout layout;
+  if (!parseEdgeLayout(cl_options["layout"].as<std::string>(), layout)) {
+    std::cout << "Unknown edge layout!" << std::endl;
+    return -1;
+  }
+  if (layout == SOA_LAYOUT && algorithm != "kruskal") {
+    std::cout << algorithm << " needs the aos layout!" << std::endl;
+    return -1;
+  }
+
+  bool stream = cl_options["stream"].as<bool>();
+  bool external = cl_options["external"].as<bool>();
+  if ((stream || external) &&
+      (layout == SOA_LAYOUT || algorithm != "kruskal")) {
+    std::cout << "stream and external need kruskal with the aos layout!"
+              << std::endl;
+    return -1;
+  }
+  if (stream && external) {
+    std::cout << "Pick one of stream and external!" << std::endl;
+    return -1;
+  }
+  if (external) {
+    size_t mem_budget = cl_options["memBudget"].as<size_t>() << 20;
+    return mst_external(input_file_path, sort_method, mem_budget,
+                        cl_options["tmpDir"].as<std::string>())
+               ? 0
+               : 2;
+  }
+  if (stream) {
+    size_t chunk_edges =
+        std::max<size_t>(1, cl_options["chunkEdges"].as<size_t>());
+    return mst_stream(input_file_path, sort_method, chunk_edges) ? 0 : 2;
+  }
+
+  g.readGraph(input_file_path);
 
-  mst_serial(std::ref(g));
+  mst_serial(std::ref(g), algorithm, sort_method, layout);
 
   return 0;
 }
@@ -0,0 +1,126 @@
+#!/bin/bash
+# Runs every engine mode on the edge lists in tests/graphs and compares the
+# reported MST weight with the known one. Run `make check`, or this script
+# from the project root after `make`. MPIRUN overrides the MPI launcher,
+# e.g. MPIRUN="mpirun --oversubscribe -n".
+
+cd "$(dirname "$0")/.." || exit 1
+MPIRUN=${MPIRUN:-mpirun -n}
+GRAPHS=tests/graphs
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT
+failures=0
+
+# expect_weight <weight> <command...>: the command reports an MST of weight.
+expect_weight() {
+  local weight=$1
+  shift
+  local out
+  out=$("$@" 2>&1)
+  local status=$?
+  local actual
+  actual=$(echo "$out" | sed -n 's/^Total weight of the MST: //p' | tail -1)
+  if [ $status -ne 0 ] || [ "$actual" != "$weight" ]; then
+    echo "FAILED: $* (exit $status, weight '$actual', expected $weight)"
+    failures=$((failures + 1))
+  fi
+}
+
+# expect_error <message> <command...>: the command fails with message.
+expect_error() {
+  local message=$1
+  shift
+  local out
+  out=$("$@" 2>&1)
+  local status=$?
+  if [ $status -eq 0 ] || ! echo "$out" | grep -q "$message"; then
+    echo "FAILED: $* (exit $status, expected '$message')"
+    failures=$((failures + 1))
+  fi
+}
+
+# expect_output <message> <command...>: the command succeeds and prints
+# message.
+expect_output() {
+  local message=$1
+  shift
+  local out
+  out=$("$@" 2>&1)
+  local status=$?
+  if [ $status -ne 0 ] || ! echo "$out" | grep -q "$message"; then
+    echo "FAILED: $* (exit $status, expected '$message')"
+    failures=$((failures + 1))
+  fi
+}
+
+# check_graph <graph> <weight>: every engine mode on the text edge list and
+# on its binary conversions.
+check_graph() {
+  local text=$GRAPHS/$1 weight=$2
+  local name=${1%.txt}
+  local bin=$TMP/$name.bin sorted=$TMP/${name}_sorted.bin
+  ./input_graph/graph_converter --inputFile "$text" --outputFile "$bin" \
+    > /dev/null
+  ./input_graph/graph_converter --inputFile "$text" --outputFile "$sorted" \
+    --sortByWeight > /dev/null
+  for input in "$text" "$bin" "$sorted"; do
+    for sort in std quick radix radix_keys; do
+      expect_weight "$weight" ./mst_serial --inputFile "$input" --sort $sort
+    done
+    for algo in filter_kruskal prim; do
+      expect_weight "$weight" ./mst_serial --inputFile "$input" --algo $algo
+    done
+    expect_weight "$weight" ./mst_serial --inputFile "$input" --layout soa
+    expect_weight "$weight" ./mst_serial --inputFile "$input" --stream \
+      --chunkEdges 2
+    expect_weight "$weight" ./mst_serial --inputFile "$input" --external \
+      --memBudget 1 --tmpDir "$TMP"
+    for algo in kruskal boruvka; do
+      expect_weight "$weight" ./mst_parallel --inputFile "$input" \
+        --nThreads 3 --algo $algo
+    done
+    expect_weight "$weight" ./mst_parallel --inputFile "$input" --nThreads 3 \
+      --overlapLoad
+    for reduce in tree gather stream; do
+      expect_weight "$weight" $MPIRUN 3 ./mst_MPI --inputFile "$input" \
+        --reduce $reduce
+    done
+    expect_weight "$weight" $MPIRUN 3 ./mst_MPI --inputFile "$input" \
+      --io root
+    expect_weight "$weight" $MPIRUN 3 ./mst_MPI --inputFile "$input" \
+      --algo boruvka
+  done
+}
+
+check_graph malformed.txt 15
+# Its id 2147483647 leaves no room for n = max id + 1, so the line is
+# skipped as out of range.
+SKIPPED="skipped 1 lines with out-of-range values"
+expect_output "$SKIPPED" ./mst_serial --inputFile $GRAPHS/malformed.txt
+expect_output "$SKIPPED" ./mst_parallel --inputFile $GRAPHS/malformed.txt
+expect_output "$SKIPPED" $MPIRUN 3 ./mst_MPI --inputFile \
+  $GRAPHS/malformed.txt
+check_graph forest.txt 18
+# Negative weights must sort below the positive ones in every engine.
+check_graph negative.txt -3
+
+# Binary edge lists with an id outside [0, n): -7 in an unsorted file and n
+# in one flagged as sorted by weight.
+BAD_ID="unsupported binary header"
+for bad in negative_id.bin large_id_sorted.bin; do
+  expect_error "$BAD_ID" ./mst_serial --inputFile $GRAPHS/$bad
+  expect_error "$BAD_ID" ./mst_serial --inputFile $GRAPHS/$bad --stream \
+    --chunkEdges 2
+  expect_error "$BAD_ID" ./mst_serial --inputFile $GRAPHS/$bad --external \
+    --memBudget 1 --tmpDir "$TMP"
+  expect_error "$BAD_ID" ./mst_parallel --inputFile $GRAPHS/$bad
+  expect_error "$BAD_ID" ./mst_parallel --inputFile $GRAPHS/$bad \
+    --overlapLoad
+  expect_error "$BAD_ID" $MPIRUN 3 ./mst_MPI --inputFile $GRAPHS/$bad
+done
+
+if [ $failures -ne 0 ]; then
+  echo "$failures checks FAILED"
+  exit 1
+fi
+echo "All checks passed"